@@ -156,6 +156,25 @@ void Application::OnDeinitialization() noexcept
 	gApplication.reset();
 }
 
+void Application::OnSIMDLevelOverrideChanged(IProperty* prop)noexcept
+{
+	if (prop == nullptr || m_Library.expired())
+		return;
+
+	auto lib = m_Library.lock();
+	const auto value = ((SIMDLevelOverrideProp_t*)prop)->GetValueCopy();
+	const auto level = value.empty() ? SIMDLevel_t::COUNT : TEnum<SIMDLevel_t>::FromString(StringView{ value.c_str(), value.size() });
+	if (!value.empty() && level == SIMDLevel_t::COUNT)
+	{
+		lib->LogWarning(Format("Unknown SIMD level '%s' on the property '%s', the best supported one is used.", value.c_str(), SIMDLevelOverrideName.data()));
+		return;
+	}
+
+	const auto res = SIMDDispatch::SetLevelOverride(level);
+	if (res.HasFailed())
+		lib->LogWarning(res.GetFailMessage());
+}
+
 void Application::OnActivation(UNUSED const PInterface& oldDefault) noexcept
 {
 	/* No-op */
@@ -247,10 +266,29 @@ void Application::InitProperties()noexcept
 		loadedLibrariesProp = (WPtr<LoadedLibrariesProp_t>)loadedLibrariesResult.GetValue();
 	}
 	m_Properties[(sizet)LoadedLibraries] = (WPtr<LoadedLibrariesProp_t>)std::move(loadedLibrariesProp);
+
+	WPtr<SIMDLevelOverrideProp_t> simdLevelOverrideProp;
+	result = lib->GetProperty(SIMDLevelOverrideName);
+	if (result.IsOk())
+		simdLevelOverrideProp = result.GetValue();
+
+	if (simdLevelOverrideProp.expired())
+	{
+		auto simdLevelOverrideResult = CreateProperty<greaper::String>(m_Library, SIMDLevelOverrideName, {},
+			"Forces the SIMD level of the dispatched kernels, one of Scalar, SSE42, AVX2 or AVX512, empty for the best supported one."sv, false, true, {});
+		Verify(simdLevelOverrideResult.IsOk(), "Couldn't create the property '%s' msg: %s", SIMDLevelOverrideName.data(), simdLevelOverrideResult.GetFailMessage().c_str());
+		simdLevelOverrideProp = (WPtr<SIMDLevelOverrideProp_t>)simdLevelOverrideResult.GetValue();
+	}
+	auto simdLevelOverride = simdLevelOverrideProp.lock();
+	simdLevelOverride->GetOnModificationEvent().Connect(m_OnSIMDLevelOverrideProp, [this](IProperty* prop) { OnSIMDLevelOverrideChanged(prop); });
+	OnSIMDLevelOverrideChanged(simdLevelOverride.get());
+	m_Properties[(sizet)SIMDLevelOverride] = std::move(simdLevelOverrideProp);
 }
 
 void Application::DeinitProperties()noexcept
 {
+	m_OnSIMDLevelOverrideProp.Disconnect();
+
 	for (auto& prop : m_Properties)
 		prop.reset();
 }
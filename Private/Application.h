@@ -25,11 +25,13 @@ namespace greaper::core
 			ApplicationVersion,
 			CompilationInfo,
 			LoadedLibraries,
+			SIMDLevelOverride,
 
 			COUNT
 		};
 
 		mutable OnInterfaceActivationEvent_t m_OnInterfaceActivation;
+		SIMDLevelOverrideProp_t::ModificationEventHandler_t m_OnSIMDLevelOverrideProp;
 
 		struct LibInfo
 		{
@@ -56,6 +58,8 @@ namespace greaper::core
 
 		void UpdateActiveInterfaceList()noexcept;
 
+		void OnSIMDLevelOverrideChanged(IProperty* prop)noexcept;
+
 	public:
 		Application();
 		~Application()noexcept;
@@ -118,6 +122,8 @@ namespace greaper::core
 
 		WPtr<AppInstanceProp_t> GetAppInstance()const noexcept override { return (WPtr<AppInstanceProp_t>)m_Properties[(std::size_t)AppInstance]; }
 
+		WPtr<SIMDLevelOverrideProp_t> GetSIMDLevelOverride()const noexcept override { return (WPtr<SIMDLevelOverrideProp_t>)m_Properties[(std::size_t)SIMDLevelOverride]; }
+
 		NODISCARD Vector<PGreaperLib> GetRegisteredLibrariesCopy()const noexcept override
 		{
 			Vector<PGreaperLib> vec{ m_Libraries.size()};
@@ -307,7 +307,7 @@ void LogManager::_Log(const LogData& data)noexcept
 		m_Scheduler->AddTask("LogTask", [data, this]()
 			{ 
 				LogToWriters(data);
-			});
+			}, TaskPriority_t::Background);
 #else
 		m_QueueMutex.lock();
 		m_QueuedMessages.push_back(data);
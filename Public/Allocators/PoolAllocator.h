@@ -146,6 +146,20 @@ namespace greaper
 			return m_FreeBlock->Alloc();
 		}
 
+		/*** Allocates count elements into elems taking the lock only once */
+		INLINE void AllocBatch(void** elems, sizet count)noexcept
+		{
+			LOCK(m_Mutex);
+			for(sizet i = 0; i < count; ++i)
+			{
+				if(!m_FreeBlock || m_FreeBlock->FreeElems == 0)
+					AllocBlock();
+
+				++m_TotalUsedElems;
+				elems[i] = m_FreeBlock->Alloc();
+			}
+		}
+
 		template<class T, typename... Args>
 		INLINE T* Construct(Args&&... args)noexcept
 		{
@@ -160,31 +174,15 @@ namespace greaper
 		INLINE void Dealloc(void* elem)override
 		{
 			LOCK(m_Mutex);
-			MemBlock_t* curBlock = m_FreeBlock;
-			while(curBlock)
-			{
-				// Is elem inside the current block?
-				if(elem >= curBlock->Data && elem < (curBlock->Data + BlockDataSize))
-				{
-					curBlock->Dealloc(elem);
-					--m_TotalUsedElems;
-
-					if(curBlock->FreeElems == 0 && curBlock->NextBlock)
-					{
-						const auto totalSpace = (m_UsedBlocks - 1) * ElemPerBlock;
-						const auto freeSpace = totalSpace - m_TotalUsedElems;
+			DeallocUnlocked(elem);
+		}
 
-						if(freeSpace > (ElemPerBlock / 2))
-						{
-							m_FreeBlock = curBlock->NextBlock;
-							DeallocBlock(curBlock);
-						}
-					}
-					return;
-				}
-				curBlock = curBlock->NextBlock;
-			}
-			Break("Trying to dealloc an elem from a PoolAllocator, but it was not found in any MemBlock!");
+		/*** Deallocates count elements taking the lock only once */
+		INLINE void DeallocBatch(void* const* elems, sizet count)noexcept
+		{
+			LOCK(m_Mutex);
+			for(sizet i = 0; i < count; ++i)
+				DeallocUnlocked(elems[i]);
 		}
 
 		template<class T>
@@ -210,6 +208,41 @@ namespace greaper
 		sizet m_UsedBlocks;
 		sizet m_TotalUsedElems;
 
+		INLINE void DeallocUnlocked(void* elem)noexcept
+		{
+			MemBlock_t* prevBlock = nullptr;
+			MemBlock_t* curBlock = m_FreeBlock;
+			while(curBlock)
+			{
+				// Is elem inside the current block?
+				if(elem >= curBlock->Data && elem < (curBlock->Data + BlockDataSize))
+				{
+					curBlock->Dealloc(elem);
+					--m_TotalUsedElems;
+
+					// Release the block once it's empty, if the others have enough free space
+					if(curBlock->FreeElems == ElemPerBlock && m_UsedBlocks > 1)
+					{
+						const auto totalSpace = (m_UsedBlocks - 1) * ElemPerBlock;
+						const auto freeSpace = totalSpace - m_TotalUsedElems;
+
+						if(freeSpace > (ElemPerBlock / 2))
+						{
+							if(prevBlock)
+								prevBlock->NextBlock = curBlock->NextBlock;
+							else
+								m_FreeBlock = curBlock->NextBlock;
+							DeallocBlock(curBlock);
+						}
+					}
+					return;
+				}
+				prevBlock = curBlock;
+				curBlock = curBlock->NextBlock;
+			}
+			Break("Trying to dealloc an elem from a PoolAllocator, but it was not found in any MemBlock!");
+		}
+
 		INLINE void DestroySelf()noexcept
 		{
 			MemBlock_t* curBlock = m_FreeBlock;
@@ -234,6 +267,7 @@ namespace greaper
 				{
 					nBlock = nextBlock;
 					curBlock->NextBlock = nBlock->NextBlock;
+					nBlock->NextBlock = m_FreeBlock;
 					break;
 				}
 				curBlock = nextBlock;
@@ -251,9 +285,9 @@ namespace greaper
 				nBlock = new((void*)block)MemBlock_t((uint8*)blockData);
 
 				nBlock->NextBlock = m_FreeBlock;
+				++m_UsedBlocks;
 			}
 			m_FreeBlock = nBlock;
-			++m_UsedBlocks;
 			return nBlock;
 		}
 
@@ -0,0 +1,339 @@
+/***********************************************************************************
+*   Copyright 2022 Marcos Sánchez Torrent.                                         *
+*   All Rights Reserved.                                                           *
+***********************************************************************************/
+
+#pragma once
+
+namespace greaper
+{
+	namespace Impl
+	{
+		class ThreadCachedPoolBase
+		{
+		public:
+			virtual ~ThreadCachedPoolBase() = default;
+
+		protected:
+			/*** Called from the exit of a thread which used the pool, only while the pool is alive */
+			virtual void ReleaseThreadCache(void* cache)noexcept = 0;
+
+			friend struct PoolThreadCacheTable;
+		};
+
+		/*** Pools with thread caches alive, the exit of a thread only releases its caches from them
+		*	Ids are never reused, so a thread can't mistake the cache of a destroyed pool with a new one.
+		*/
+		struct ThreadCachedPoolRegistry
+		{
+			// Pools can be static objects, so they are function local statics
+			NODISCARD static Mutex& GetMutex()noexcept
+			{
+				static Mutex mutex;
+				return mutex;
+			}
+
+			NODISCARD static UnorderedMap<uint64, ThreadCachedPoolBase*>& GetPools()noexcept
+			{
+				static UnorderedMap<uint64, ThreadCachedPoolBase*> pools;
+				return pools;
+			}
+
+			NODISCARD static uint64 Register(ThreadCachedPoolBase* pool)noexcept
+			{
+				static std::atomic<uint64> nextID{ 1 };
+				const auto id = nextID.fetch_add(1, std::memory_order_relaxed);
+				auto lck = Lock(GetMutex());
+				GetPools().insert_or_assign(id, pool);
+				return id;
+			}
+
+			static void Unregister(uint64 id)noexcept
+			{
+				auto lck = Lock(GetMutex());
+				GetPools().erase(id);
+			}
+		};
+
+		/*** Caches of the current thread, one per pool it has allocated from */
+		struct PoolThreadCacheTable
+		{
+			struct Entry
+			{
+				uint64 PoolID;
+				ThreadCachedPoolBase* Pool;
+				void* Cache;
+			};
+			Vector<Entry> Entries;
+
+			INLINE ~PoolThreadCacheTable()noexcept
+			{
+				auto lck = Lock(ThreadCachedPoolRegistry::GetMutex());
+				const auto& pools = ThreadCachedPoolRegistry::GetPools();
+				for (const auto& entry : Entries)
+				{
+					if (pools.find(entry.PoolID) != pools.end())
+						entry.Pool->ReleaseThreadCache(entry.Cache);
+				}
+				Entries.clear();
+			}
+
+			NODISCARD INLINE void* Find(uint64 poolID)const noexcept
+			{
+				for (const auto& entry : Entries)
+				{
+					if (entry.PoolID == poolID)
+						return entry.Cache;
+				}
+				return nullptr;
+			}
+		};
+
+		inline thread_local PoolThreadCacheTable tl_PoolThreadCaches;
+		// Trivial thread_locals, avoid the initialization check of the table on the common path
+		inline thread_local uint64 tl_LastPoolID = 0;
+		inline thread_local void* tl_LastPoolCache = nullptr;
+	}
+
+	/*** Thread caching front end of a locked PoolAllocator
+	*
+	*	Each thread keeps a magazine of up to MagazineSize free elements per
+	*	pool, Alloc and Dealloc only touch the magazine of the calling thread,
+	*	without any lock. An empty magazine is refilled with MagazineSize / 2
+	*	elements taking the pool lock once, and a full one returns half of them
+	*	the same way. Every element remembers the thread cache which handed it
+	*	out, so the frees from other threads are pushed lock-free to the list
+	*	of that cache and reused by its owner on its next refill.
+	*	Caches of finished threads give their elements back to the pool and
+	*	are adopted by new threads. Each element has a header of one pointer,
+	*	rounded up to Alignment. The pool mustn't be used from thread_local
+	*	destructors.
+	*/
+	template<sizet ElemSize, sizet ElemPerBlock = 512, sizet Alignment = sizeof(ptruint), class _Allocator_ = GenericAllocator, sizet MagazineSize = 64>
+	class ThreadCachedPoolAllocator final : public IPoolAllocator, public Impl::ThreadCachedPoolBase
+	{
+	private:
+		static constexpr sizet HeaderSize = Impl::PoolAlignedValueSize<sizeof(ptruint), Alignment>;
+		static constexpr sizet CentralElemSize = HeaderSize + Impl::PoolAlignedValueSize<ElemSize, Alignment>;
+		static constexpr sizet BatchSize = MagazineSize / 2;
+
+		struct ThreadCache
+		{
+			std::array<void*, MagazineSize> Magazine;
+			sizet Count = 0;
+			ThreadCache* NextCache = nullptr;
+			bool Orphaned = false;
+			// Pushed by other threads, on its own line to not bother the owner
+			alignas(CACHE_LINE_SIZE) std::atomic<void*> RemoteFrees{ nullptr };
+		};
+
+		struct ElemHeader
+		{
+			ThreadCache* Owner;
+		};
+
+	public:
+		INLINE ThreadCachedPoolAllocator()noexcept
+			:m_Caches(nullptr)
+		{
+			static_assert(ElemSize >= sizeof(ptruint), "You must provide elements with more size.");
+			static_assert(MagazineSize >= 2, "Magazines must hold at least 2 elements.");
+			m_PoolID = Impl::ThreadCachedPoolRegistry::Register(this);
+		}
+
+		ThreadCachedPoolAllocator(const ThreadCachedPoolAllocator&) = delete;
+		ThreadCachedPoolAllocator& operator=(const ThreadCachedPoolAllocator&) = delete;
+
+		INLINE ~ThreadCachedPoolAllocator()noexcept
+		{
+			// From now on no thread exit will touch our caches
+			Impl::ThreadCachedPoolRegistry::Unregister(m_PoolID);
+
+			LOCK(m_CacheMutex);
+			ThreadCache* cache = m_Caches;
+			while (cache)
+			{
+				auto* nextCache = cache->NextCache;
+				FlushAll(*cache);
+				DestroyAligned<ThreadCache, _Allocator_>(cache);
+				cache = nextCache;
+			}
+			m_Caches = nullptr;
+		}
+
+		INLINE void* Alloc()override
+		{
+			auto* cache = GetOrCreateThreadCache();
+			if (cache->Count == 0)
+				Refill(*cache);
+			return cache->Magazine[--cache->Count];
+		}
+
+		template<class T, typename... Args>
+		INLINE T* Construct(Args&&... args)noexcept
+		{
+			T* elem = (T*)Alloc();
+			VerifyNotNull(elem, "Coudn't construct a nullptr elem!");
+
+			new(elem)T(std::forward<Args>(args)...);
+
+			return elem;
+		}
+
+		INLINE void Dealloc(void* elem)override
+		{
+			auto* owner = GetHeader(elem)->Owner;
+			// Threads which only free don't need a cache
+			auto* cache = FindThreadCache();
+			if (owner != cache)
+			{
+				PushRemote(*owner, elem);
+				return;
+			}
+			if (cache->Count == MagazineSize)
+				Flush(*cache, BatchSize);
+			cache->Magazine[cache->Count++] = elem;
+		}
+
+		template<class T>
+		INLINE void Destruct(T* elem)
+		{
+			elem->~T();
+			this->Dealloc((void*)elem);
+		}
+
+		INLINE sizet GetElementSize()const override { return ElemSize; }
+
+		INLINE sizet GetElementsPerBlock()const override { return ElemPerBlock; }
+
+		INLINE sizet GetAlignment()const override { return Alignment; }
+
+		INLINE bool IsLocked()const override { return true; }
+
+		NODISCARD INLINE sizet GetMagazineSize()const noexcept { return MagazineSize; }
+
+	private:
+		PoolAllocator<CentralElemSize, ElemPerBlock, Alignment, _Allocator_, true> m_Central;
+		Mutex m_CacheMutex;
+		ThreadCache* m_Caches;
+		uint64 m_PoolID;
+
+		NODISCARD INLINE static ElemHeader* GetHeader(void* elem)noexcept
+		{
+			return (ElemHeader*)((uint8*)elem - HeaderSize);
+		}
+
+		NODISCARD INLINE ThreadCache* FindThreadCache()const noexcept
+		{
+			if (Impl::tl_LastPoolID == m_PoolID)
+				return (ThreadCache*)Impl::tl_LastPoolCache;
+
+			auto* cache = (ThreadCache*)Impl::tl_PoolThreadCaches.Find(m_PoolID);
+			if (cache != nullptr)
+			{
+				Impl::tl_LastPoolID = m_PoolID;
+				Impl::tl_LastPoolCache = cache;
+			}
+			return cache;
+		}
+
+		NODISCARD INLINE ThreadCache* GetOrCreateThreadCache()noexcept
+		{
+			auto* cache = FindThreadCache();
+			if (cache != nullptr)
+				return cache;
+
+			{
+				LOCK(m_CacheMutex);
+				// Adopt the cache of a finished thread, its elements may still come back from other threads
+				for (cache = m_Caches; cache != nullptr; cache = cache->NextCache)
+				{
+					if (cache->Orphaned)
+						break;
+				}
+				if (cache == nullptr)
+				{
+					cache = ConstructAligned<ThreadCache, _Allocator_>(alignof(ThreadCache));
+					cache->NextCache = m_Caches;
+					m_Caches = cache;
+				}
+				cache->Orphaned = false;
+			}
+
+			Impl::tl_PoolThreadCaches.Entries.push_back({ m_PoolID, this, cache });
+			Impl::tl_LastPoolID = m_PoolID;
+			Impl::tl_LastPoolCache = cache;
+			return cache;
+		}
+
+		INLINE void ReleaseThreadCache(void* cachePtr)noexcept override
+		{
+			auto* cache = (ThreadCache*)cachePtr;
+			LOCK(m_CacheMutex);
+			FlushAll(*cache);
+			cache->Orphaned = true;
+		}
+
+		INLINE static void PushRemote(ThreadCache& owner, void* elem)noexcept
+		{
+			auto& head = owner.RemoteFrees;
+			void* expected = head.load(std::memory_order_relaxed);
+			do
+			{
+				*(void**)elem = expected;
+			} while (!head.compare_exchange_weak(expected, elem, std::memory_order_release, std::memory_order_relaxed));
+		}
+
+		/*** Expects an empty magazine, takes first the elements freed by other threads */
+		INLINE void Refill(ThreadCache& cache)noexcept
+		{
+			// Only the owner takes the list, taking it whole there's no ABA
+			void* remote = cache.RemoteFrees.exchange(nullptr, std::memory_order_acquire);
+			while (remote != nullptr)
+			{
+				void* next = *(void**)remote;
+				if (cache.Count == MagazineSize)
+					Flush(cache, BatchSize);
+				cache.Magazine[cache.Count++] = remote;
+				remote = next;
+			}
+			if (cache.Count > 0)
+				return;
+
+			std::array<void*, BatchSize> batch;
+			m_Central.AllocBatch(batch.data(), BatchSize);
+			for (sizet i = 0; i < BatchSize; ++i)
+			{
+				auto* header = (ElemHeader*)batch[i];
+				header->Owner = &cache;
+				cache.Magazine[cache.Count++] = (uint8*)header + HeaderSize;
+			}
+		}
+
+		/*** Returns the last count elements of the magazine to the pool */
+		INLINE void Flush(ThreadCache& cache, sizet count)noexcept
+		{
+			const sizet first = cache.Count - count;
+			for (sizet i = first; i < cache.Count; ++i)
+				cache.Magazine[i] = GetHeader(cache.Magazine[i]);
+			m_Central.DeallocBatch(&cache.Magazine[first], count);
+			cache.Count = first;
+		}
+
+		/*** Returns the magazine and the pending remote frees to the pool */
+		INLINE void FlushAll(ThreadCache& cache)noexcept
+		{
+			void* remote = cache.RemoteFrees.exchange(nullptr, std::memory_order_acquire);
+			while (remote != nullptr)
+			{
+				void* next = *(void**)remote;
+				if (cache.Count == MagazineSize)
+					Flush(cache, cache.Count);
+				cache.Magazine[cache.Count++] = remote;
+				remote = next;
+			}
+			if (cache.Count > 0)
+				Flush(cache, cache.Count);
+		}
+	};
+}
@@ -0,0 +1,123 @@
+/***********************************************************************************
+*   Copyright 2022 Marcos Sánchez Torrent.                                         *
+*   All Rights Reserved.                                                           *
+***********************************************************************************/
+
+#pragma once
+
+#ifndef CORE_BOUNDED_MPMC_QUEUE_H
+#define CORE_BOUNDED_MPMC_QUEUE_H 1
+
+//#include "../CorePrerequisites.h"
+#include <atomic>
+
+namespace greaper
+{
+	/*** Lock-free bounded multi-producer multi-consumer queue
+	*
+	*	Dmitry Vyukov's bounded queue, each cell carries a sequence number
+	*	that tells whether is ready to be written or read on the current lap,
+	*	so producers and consumers only contend on their own index.
+	*	TryPush/TryPop never block, they return false when the queue is full
+	*	or empty, it's up to the user to wait. Note that TryPush also fails
+	*	while the consumer of the previous lap is still moving out the value
+	*	of that cell, even if the queue is not full anymore.
+	*/
+	template<class T, sizet Capacity>
+	class BoundedMPMCQueue
+	{
+		static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "BoundedMPMCQueue capacity must be a power of two.");
+		static_assert(std::is_nothrow_move_constructible_v<T> && std::is_nothrow_move_assignable_v<T>, "BoundedMPMCQueue requires nothrow movable elements.");
+
+		static constexpr sizet IndexMask = Capacity - 1;
+
+		struct Cell
+		{
+			std::atomic<sizet> Sequence;
+			T Value;
+		};
+
+	public:
+		BoundedMPMCQueue()noexcept
+		{
+			for (sizet i = 0; i < Capacity; ++i)
+				m_Cells[i].Sequence.store(i, std::memory_order_relaxed);
+		}
+
+		BoundedMPMCQueue(const BoundedMPMCQueue&) = delete;
+		BoundedMPMCQueue& operator=(const BoundedMPMCQueue&) = delete;
+
+		NODISCARD static constexpr sizet GetCapacity()noexcept { return Capacity; }
+
+		NODISCARD bool TryPush(T value)noexcept
+		{
+			Cell* cell;
+			sizet pos = m_EnqueuePos.load(std::memory_order_relaxed);
+			while (true)
+			{
+				cell = &m_Cells[pos & IndexMask];
+				const sizet seq = cell->Sequence.load(std::memory_order_acquire);
+				const auto diff = (ssizet)seq - (ssizet)pos;
+				if (diff == 0)
+				{
+					if (m_EnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						break;
+				}
+				else if (diff < 0)
+				{
+					return false; // Full
+				}
+				else
+				{
+					pos = m_EnqueuePos.load(std::memory_order_relaxed);
+				}
+			}
+			cell->Value = std::move(value);
+			cell->Sequence.store(pos + 1, std::memory_order_release);
+			return true;
+		}
+
+		NODISCARD bool TryPop(T& value)noexcept
+		{
+			Cell* cell;
+			sizet pos = m_DequeuePos.load(std::memory_order_relaxed);
+			while (true)
+			{
+				cell = &m_Cells[pos & IndexMask];
+				const sizet seq = cell->Sequence.load(std::memory_order_acquire);
+				const auto diff = (ssizet)seq - (ssizet)(pos + 1);
+				if (diff == 0)
+				{
+					if (m_DequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						break;
+				}
+				else if (diff < 0)
+				{
+					return false; // Empty
+				}
+				else
+				{
+					pos = m_DequeuePos.load(std::memory_order_relaxed);
+				}
+			}
+			value = std::move(cell->Value);
+			cell->Sequence.store(pos + Capacity, std::memory_order_release);
+			return true;
+		}
+
+		/*** Approximated amount of elements, only exact when no one is pushing or popping */
+		NODISCARD sizet GetSizeApprox()const noexcept
+		{
+			const auto enq = m_EnqueuePos.load(std::memory_order_relaxed);
+			const auto deq = m_DequeuePos.load(std::memory_order_relaxed);
+			return enq > deq ? enq - deq : 0;
+		}
+
+	private:
+		alignas(CACHE_LINE_SIZE) Cell m_Cells[Capacity];
+		alignas(CACHE_LINE_SIZE) std::atomic<sizet> m_EnqueuePos{ 0 };
+		alignas(CACHE_LINE_SIZE) std::atomic<sizet> m_DequeuePos{ 0 };
+	};
+}
+
+#endif /* CORE_BOUNDED_MPMC_QUEUE_H */
@@ -73,6 +73,91 @@ namespace greaper
 
 		constexpr CPUInfo()noexcept = default;
 	};
+
+	namespace ECPUCacheType
+	{
+		enum Type
+		{
+			DATA,
+			INSTRUCTION,
+			UNIFIED
+		};
+	}
+	using CPUCacheType_t = ECPUCacheType::Type;
+
+	struct CPUCacheInfo
+	{
+		uint32 Level = 0;
+		CPUCacheType_t Type = CPUCacheType_t::UNIFIED;
+		// In bytes, of each instance
+		uint32 Size = 0;
+		uint32 LineSize = 0;
+		uint32 Associativity = 0;
+		// Logical CPUs sharing each instance of this cache
+		Vector<Vector<uint32>> SharingGroups;
+	};
+
+	/*** Hardware layout of the logical CPUs
+	*	Logical CPUs are referred by the index the OS gives them, the same used
+	*	by ThreadConfig::Affinity. Filled by OSPlatform::PerLibraryInit from the
+	*	OS when it gives this information, or from cpuid otherwise, in which
+	*	case every logical CPU is taken as a physical core on a single node.
+	*/
+	struct CPUTopology
+	{
+		uint32 LogicalCoreCount = 0;
+		uint32 PhysicalCoreCount = 0;
+		uint32 PackageCount = 0;
+		// Logical CPUs of each physical core, SMT siblings share its execution units and first cache levels
+		Vector<Vector<uint32>> SMTSiblings;
+		// One per level and type
+		Vector<CPUCacheInfo> Caches;
+		// Logical CPUs of each NUMA node, indexed by the node number
+		Vector<Vector<uint32>> NUMANodes;
+
+		/*** Returns nullptr if unknown, a unified cache is returned for any type */
+		NODISCARD const CPUCacheInfo* GetCache(uint32 level, CPUCacheType_t type = CPUCacheType_t::DATA)const noexcept
+		{
+			for (const auto& cache : Caches)
+			{
+				if (cache.Level == level && (cache.Type == type || cache.Type == CPUCacheType_t::UNIFIED))
+					return &cache;
+			}
+			return nullptr;
+		}
+
+		/*** Line size of the first data cache, CACHE_LINE_SIZE if unknown */
+		NODISCARD uint32 GetCacheLineSize()const noexcept
+		{
+			const auto* cache = GetCache(1);
+			return cache != nullptr && cache->LineSize > 0 ? cache->LineSize : CACHE_LINE_SIZE;
+		}
+
+		/*** Returns -1 if unknown */
+		NODISCARD int32 GetNUMANodeOfCPU(uint32 cpu)const noexcept
+		{
+			for (sizet node = 0; node < NUMANodes.size(); ++node)
+			{
+				if (std::find(NUMANodes[node].begin(), NUMANodes[node].end(), cpu) != NUMANodes[node].end())
+					return (int32)node;
+			}
+			return -1;
+		}
+
+		/*** Adds an instance of a cache, descriptions of an already known level and type are ignored */
+		void AddCacheInstance(const CPUCacheInfo& description, const Vector<uint32>& cpus)noexcept
+		{
+			auto it = std::find_if(Caches.begin(), Caches.end(), [&description](const CPUCacheInfo& cache) { return cache.Level == description.Level && cache.Type == description.Type; });
+			if (it == Caches.end())
+			{
+				Caches.push_back(description);
+				Caches.back().SharingGroups.clear();
+				it = Caches.end() - 1;
+			}
+			if (!cpus.empty() && std::find(it->SharingGroups.begin(), it->SharingGroups.end(), cpus) == it->SharingGroups.end())
+				it->SharingGroups.push_back(cpus);
+		}
+	};
 }
 
 #endif /* CORE_CPU_INFO_H */
\ No newline at end of file
@@ -0,0 +1,82 @@
+/***********************************************************************************
+*   Copyright 2022 Marcos Sánchez Torrent.                                         *
+*   All Rights Reserved.                                                           *
+***********************************************************************************/
+
+#pragma once
+
+#ifndef CORE_CHECKSUM_H
+#define CORE_CHECKSUM_H 1
+
+#include "SIMDDispatch.h"
+
+#if PLT_WINDOWS
+#include <intrin.h>
+#else
+#include <nmmintrin.h>
+#endif
+
+namespace greaper
+{
+	namespace Impl
+	{
+		/*** Reflected Castagnoli polynomial, the one of the SSE4.2 crc32 instruction */
+		static constexpr uint32 CRC32CPolynomial = 0x82F63B78;
+
+		struct CRC32CTable
+		{
+			uint32 Values[256]{};
+
+			constexpr CRC32CTable()noexcept
+			{
+				for (uint32 i = 0; i < 256; ++i)
+				{
+					uint32 crc = i;
+					for (uint32 bit = 0; bit < 8; ++bit)
+						crc = (crc >> 1) ^ ((crc & 1) != 0 ? CRC32CPolynomial : 0);
+					Values[i] = crc;
+				}
+			}
+		};
+
+		static constexpr CRC32CTable gCRC32CTable{};
+
+		// Called through the kernel, not worth forcing their inlining
+		inline uint32 CRC32CScalar(const void* data, sizet size, uint32 crc)noexcept
+		{
+			const auto* bytes = (const uint8*)data;
+			crc = ~crc;
+			for (sizet i = 0; i < size; ++i)
+				crc = gCRC32CTable.Values[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+			return ~crc;
+		}
+
+		SIMD_TARGET("sse4.2") inline uint32 CRC32CSSE42(const void* data, sizet size, uint32 crc)noexcept
+		{
+			const auto* bytes = (const uint8*)data;
+			uint64 crc64 = (uint32)~crc;
+			for (; size >= sizeof(uint64); size -= sizeof(uint64), bytes += sizeof(uint64))
+			{
+				uint64 value;
+				memcpy(&value, bytes, sizeof(value));
+				crc64 = _mm_crc32_u64(crc64, value);
+			}
+			auto crc32 = (uint32)crc64;
+			for (; size > 0; --size, ++bytes)
+				crc32 = _mm_crc32_u8(crc32, *bytes);
+			return ~crc32;
+		}
+
+		inline SIMDKernel<uint32(const void*, sizet, uint32)> gCRC32CKernel{ &CRC32CScalar, &CRC32CSSE42 };
+	}
+
+	/*** CRC-32C (Castagnoli) of size bytes, pass the previous result as crc to continue it
+	*	Uses the crc32 instruction when SSE4.2 is available, about 8 bytes per cycle.
+	*/
+	INLINE uint32 ComputeCRC32C(const void* data, sizet size, uint32 crc = 0)noexcept
+	{
+		return Impl::gCRC32CKernel(data, size, crc);
+	}
+}
+
+#endif /* CORE_CHECKSUM_H */
@@ -31,4 +31,22 @@
 #else
 #define GREAPER_DEBUG_BREAK 1
 #endif
-#endif
\ No newline at end of file
+#endif
+/**
+*	Amount of task slots of every SlimTaskScheduler, AddTask waits when all
+*	of them are in use. Must be a power of two no bigger than 256.
+*/
+#ifndef GREAPER_SLIM_TASK_CAPACITY
+#define GREAPER_SLIM_TASK_CAPACITY 32
+#endif
+
+/**
+*	Enables the coroutine support of Coroutine.h, which needs C++20.
+*/
+#ifndef GREAPER_ENABLE_COROUTINES
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define GREAPER_ENABLE_COROUTINES 1
+#else
+#define GREAPER_ENABLE_COROUTINES 0
+#endif
+#endif
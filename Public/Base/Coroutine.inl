@@ -0,0 +1,276 @@
+/***********************************************************************************
+*   Copyright 2022 Marcos Sánchez Torrent.                                         *
+*   All Rights Reserved.                                                           *
+***********************************************************************************/
+
+#pragma once
+
+//#include "../Coroutine.h"
+
+namespace greaper
+{
+	namespace Impl
+	{
+		template<class Promise>
+		INLINE std::coroutine_handle<> CoPromiseBase::FinalAwaiter::await_suspend(std::coroutine_handle<Promise> handle) noexcept
+		{
+			// Symmetric transfer, the awaiting coroutine continues without growing the stack
+			const auto continuation = handle.promise().m_Continuation;
+			if (continuation)
+				return continuation;
+			return std::noop_coroutine();
+		}
+
+		INLINE void* CoPromiseBase::operator new(sizet size)
+		{
+			return Alloc(size);
+		}
+
+		INLINE void CoPromiseBase::operator delete(void* ptr) noexcept
+		{
+			Dealloc(ptr);
+		}
+
+		INLINE void CoPromiseBase::unhandled_exception() const noexcept
+		{
+			Break("Unhandled exception on a CoTask.");
+		}
+
+		INLINE void CoPromiseBase::SetContinuation(std::coroutine_handle<> continuation) noexcept
+		{
+			m_Continuation = continuation;
+		}
+
+		template<class T>
+		INLINE CoTask<T> CoPromise<T>::get_return_object() noexcept
+		{
+			return CoTask<T>{ std::coroutine_handle<CoPromise<T>>::from_promise(*this) };
+		}
+
+		template<class T>
+		template<class U>
+		INLINE void CoPromise<T>::return_value(U&& value) noexcept
+		{
+			m_Value.emplace(std::forward<U>(value));
+		}
+
+		template<class T>
+		INLINE T CoPromise<T>::TakeResult() noexcept
+		{
+			return std::move(*m_Value);
+		}
+
+		INLINE CoTask<void> CoPromise<void>::get_return_object() noexcept
+		{
+			return CoTask<void>{ std::coroutine_handle<CoPromise<void>>::from_promise(*this) };
+		}
+
+		INLINE void* CoDetached::promise_type::operator new(sizet size)
+		{
+			return Alloc(size);
+		}
+
+		INLINE void CoDetached::promise_type::operator delete(void* ptr) noexcept
+		{
+			Dealloc(ptr);
+		}
+
+		INLINE void CoDetached::promise_type::unhandled_exception() const noexcept
+		{
+			Break("Unhandled exception on a detached coroutine.");
+		}
+
+		INLINE HTaskAwaiter::HTaskAwaiter(HTask hTask) noexcept
+			:m_Task(std::move(hTask))
+		{
+
+		}
+
+		INLINE bool HTaskAwaiter::await_ready() const noexcept
+		{
+			return m_Task.IsFinished();
+		}
+
+		INLINE bool HTaskAwaiter::await_suspend(std::coroutine_handle<> handle) noexcept
+		{
+			// If it finished meanwhile, we just continue
+			return m_Task.AddContinuation([handle]() { handle.resume(); });
+		}
+
+		INLINE SchedulerAwaiter::SchedulerAwaiter(PTaskScheduler scheduler, TaskPriority_t priority) noexcept
+			:m_Scheduler(std::move(scheduler))
+			,m_Priority(priority)
+		{
+
+		}
+
+		INLINE bool SchedulerAwaiter::await_suspend(std::coroutine_handle<> handle) noexcept
+		{
+			if (m_Scheduler == nullptr)
+				return false;
+			return m_Scheduler->AddTask("CoTaskResume"sv, [handle]() { handle.resume(); }, m_Priority).IsOk();
+		}
+
+		INLINE DelayAwaiter::DelayAwaiter(PTaskScheduler scheduler, Duration_t delay, TaskPriority_t priority) noexcept
+			:m_Scheduler(std::move(scheduler))
+			,m_Delay(delay)
+			,m_Priority(priority)
+		{
+
+		}
+
+		INLINE bool DelayAwaiter::await_suspend(std::coroutine_handle<> handle) noexcept
+		{
+			if (m_Scheduler == nullptr)
+				return false;
+			return m_Scheduler->AddDelayedTask("CoTaskDelay"sv, [handle]() { handle.resume(); }, m_Delay, m_Priority).IsOk();
+		}
+
+		INLINE HTaskAwaiter operator co_await(const HTask& hTask) noexcept
+		{
+			return HTaskAwaiter{ hTask };
+		}
+
+		template<class T>
+		inline CoDetached RunDetached(PTaskScheduler scheduler, CoTask<T> task, TaskPriority_t priority) noexcept
+		{
+			co_await ResumeOn(std::move(scheduler), priority);
+			co_await task;
+		}
+
+		template<class T>
+		inline CoDetached RunAndNotify(PTaskScheduler scheduler, CoTask<T> task, std::optional<T>& result, Mutex& mutex, Signal& signal, bool& finished) noexcept
+		{
+			co_await ResumeOn(std::move(scheduler));
+			result.emplace(co_await task);
+
+			// Notify under the lock, the waiter owns everything we reference
+			auto lck = Lock(mutex);
+			finished = true;
+			signal.notify_all();
+		}
+
+		inline CoDetached RunAndNotify(PTaskScheduler scheduler, CoTask<void> task, Mutex& mutex, Signal& signal, bool& finished) noexcept
+		{
+			co_await ResumeOn(std::move(scheduler));
+			co_await task;
+
+			auto lck = Lock(mutex);
+			finished = true;
+			signal.notify_all();
+		}
+	}
+
+	template<class T>
+	INLINE std::coroutine_handle<> CoTask<T>::Awaiter::await_suspend(std::coroutine_handle<> awaiting) noexcept
+	{
+		Handle.promise().SetContinuation(awaiting);
+		return Handle;
+	}
+
+	template<class T>
+	INLINE CoTask<T>::CoTask(CoTask&& other) noexcept
+		:m_Handle(std::exchange(other.m_Handle, nullptr))
+	{
+
+	}
+
+	template<class T>
+	INLINE CoTask<T>& CoTask<T>::operator=(CoTask&& other) noexcept
+	{
+		if (this != &other)
+		{
+			if (m_Handle)
+				m_Handle.destroy();
+			m_Handle = std::exchange(other.m_Handle, nullptr);
+		}
+		return *this;
+	}
+
+	template<class T>
+	INLINE CoTask<T>::~CoTask() noexcept
+	{
+		if (m_Handle)
+			m_Handle.destroy();
+	}
+
+	template<class T>
+	INLINE bool CoTask<T>::IsValid() const noexcept { return (bool)m_Handle; }
+
+	template<class T>
+	INLINE bool CoTask<T>::IsDone() const noexcept { return m_Handle && m_Handle.done(); }
+
+	template<class T>
+	INLINE typename CoTask<T>::Awaiter CoTask<T>::operator co_await() noexcept
+	{
+		VerifyNot(!m_Handle, "Trying to co_await an invalid CoTask.");
+		return Awaiter{ m_Handle };
+	}
+
+	template<class T>
+	INLINE CoTask<T>::CoTask(std::coroutine_handle<promise_type> handle) noexcept
+		:m_Handle(handle)
+	{
+
+	}
+
+	INLINE Impl::SchedulerAwaiter ResumeOn(PTaskScheduler scheduler, TaskPriority_t priority) noexcept
+	{
+		return Impl::SchedulerAwaiter{ std::move(scheduler), priority };
+	}
+
+	INLINE Impl::DelayAwaiter Delay(PTaskScheduler scheduler, Duration_t delay, TaskPriority_t priority) noexcept
+	{
+		return Impl::DelayAwaiter{ std::move(scheduler), delay, priority };
+	}
+
+	template<class T>
+	INLINE EmptyResult Spawn(const PTaskScheduler& scheduler, CoTask<T> task, TaskPriority_t priority) noexcept
+	{
+		if (scheduler == nullptr)
+			return Result::CreateFailure("Trying to spawn a CoTask with a nullptr scheduler."sv);
+		if (!task.IsValid())
+			return Result::CreateFailure("Trying to spawn an invalid CoTask."sv);
+
+		Impl::RunDetached(scheduler, std::move(task), priority);
+		return Result::CreateSuccess();
+	}
+
+	template<class T>
+	INLINE TResult<T> SyncWait(const PTaskScheduler& scheduler, CoTask<T> task) noexcept
+	{
+		if (scheduler == nullptr)
+			return Result::CreateFailure<T>("Trying to wait a CoTask with a nullptr scheduler."sv);
+		if (!task.IsValid())
+			return Result::CreateFailure<T>("Trying to wait an invalid CoTask."sv);
+
+		std::optional<T> result;
+		Mutex mutex;
+		Signal signal;
+		bool finished = false;
+		Impl::RunAndNotify(scheduler, std::move(task), result, mutex, signal, finished);
+
+		auto lck = UniqueLock<Mutex>(mutex);
+		while (!finished)
+			signal.wait(lck);
+		return Result::CreateSuccess(std::move(*result));
+	}
+
+	INLINE EmptyResult SyncWait(const PTaskScheduler& scheduler, CoTask<void> task) noexcept
+	{
+		if (scheduler == nullptr)
+			return Result::CreateFailure("Trying to wait a CoTask with a nullptr scheduler."sv);
+		if (!task.IsValid())
+			return Result::CreateFailure("Trying to wait an invalid CoTask."sv);
+
+		Mutex mutex;
+		Signal signal;
+		bool finished = false;
+		Impl::RunAndNotify(scheduler, std::move(task), mutex, signal, finished);
+
+		auto lck = UniqueLock<Mutex>(mutex);
+		while (!finished)
+			signal.wait(lck);
+		return Result::CreateSuccess();
+	}
+}
@@ -10,11 +10,19 @@
 
 #include "../CorePrerequisites.h"
 #include "../Enumeration.h"
+#include <bitset>
 
 ENUMERATION(ThreadState, STOPPED, SUSPENDED, RUNNING, UNMANAGED);
+ENUMERATION(ThreadSchedulingPolicy, Default, Batch, Idle, RoundRobin, FIFO);
 
 namespace greaper
 {
+	/*** Maximum amount of logical CPUs that a thread affinity can refer to */
+	static constexpr sizet MaxThreadAffinityCPUs = 1024;
+
+	/*** Bit i set allows the thread to run on the logical CPU i */
+	using ThreadAffinityMask = std::bitset<MaxThreadAffinityCPUs>;
+
 	struct ThreadConfig
 	{
 		std::function<void()> ThreadFN = nullptr;
@@ -22,6 +30,15 @@ namespace greaper
 		bool StartSuspended = false;
 		bool JoinAtDestruction = true;
 		StringView Name = "Unnamed"sv;
+		// Empty to run on any CPU
+		ThreadAffinityMask Affinity{};
+		// RoundRobin and FIFO are real-time policies, they usually require privileges
+		ThreadSchedulingPolicy_t SchedulingPolicy = ThreadSchedulingPolicy_t::Default;
+		// Only used by the real-time policies, clamped to the range of the policy
+		int32 SchedulingPriority = 0;
+		// Memory of the thread is preferably allocated from this node, and without
+		// Affinity the thread runs on its CPUs, -1 for no preference
+		int32 PreferredNUMANode = -1;
 	};
 }
 #if PLT_WINDOWS
@@ -0,0 +1,203 @@
+/***********************************************************************************
+*   Copyright 2022 Marcos Sánchez Torrent.                                         *
+*   All Rights Reserved.                                                           *
+***********************************************************************************/
+
+#pragma once
+
+#ifndef CORE_INLINE_FUNCTION_H
+#define CORE_INLINE_FUNCTION_H 1
+
+//#include "../Memory.h"
+#include <cstddef>
+
+namespace greaper
+{
+	template<class Signature, sizet InlineSize = 64>
+	class InlineFunction;
+
+	namespace Impl
+	{
+		template<class T> struct IsStdFunction : std::false_type {};
+		template<class R, class... Args> struct IsStdFunction<std::function<R(Args...)>> : std::true_type {};
+
+		template<class T> struct IsInlineFunction : std::false_type {};
+		template<class Signature, sizet InlineSize> struct IsInlineFunction<InlineFunction<Signature, InlineSize>> : std::true_type {};
+	}
+
+	/*** Move-only callable wrapper with inline storage
+	*
+	*	Works as a std::function but callables up to InlineSize bytes are stored
+	*	inside the object itself, so constructing, moving and destroying them
+	*	never touches the heap. Bigger callables, or those that may throw when
+	*	moved, are allocated with the GenericAllocator, FitsInline<F> can be
+	*	used to static_assert that a given callable doesn't do that.
+	*/
+	template<class R, class... Args, sizet InlineSize>
+	class InlineFunction<R(Args...), InlineSize>
+	{
+		enum class Operation
+		{
+			Move,
+			Destroy
+		};
+		using InvokeFn_t = R(*)(void* storage, Args&&... args);
+		using ManageFn_t = void(*)(Operation op, void* dst, void* src);
+
+	public:
+		static constexpr sizet InlineCapacity = InlineSize;
+
+		template<class F>
+		static constexpr bool FitsInline = sizeof(F) <= InlineSize
+			&& alignof(F) <= alignof(std::max_align_t)
+			&& std::is_nothrow_move_constructible_v<F>;
+
+		INLINE InlineFunction()noexcept = default;
+
+		INLINE InlineFunction(std::nullptr_t)noexcept
+		{
+
+		}
+
+		template<class F, typename std::enable_if_t<!Impl::IsInlineFunction<std::decay_t<F>>::value && std::is_invocable_r_v<R, std::decay_t<F>&, Args...>, bool> = true>
+		INLINE InlineFunction(F&& fn)noexcept
+		{
+			Assign(std::forward<F>(fn));
+		}
+
+		INLINE InlineFunction(InlineFunction&& other)noexcept
+		{
+			MoveFrom(other);
+		}
+
+		INLINE InlineFunction& operator=(InlineFunction&& other)noexcept
+		{
+			if (this != &other)
+			{
+				Reset();
+				MoveFrom(other);
+			}
+			return *this;
+		}
+
+		INLINE InlineFunction& operator=(std::nullptr_t)noexcept
+		{
+			Reset();
+			return *this;
+		}
+
+		template<class F, typename std::enable_if_t<!Impl::IsInlineFunction<std::decay_t<F>>::value && std::is_invocable_r_v<R, std::decay_t<F>&, Args...>, bool> = true>
+		INLINE InlineFunction& operator=(F&& fn)noexcept
+		{
+			Reset();
+			Assign(std::forward<F>(fn));
+			return *this;
+		}
+
+		InlineFunction(const InlineFunction&) = delete;
+		InlineFunction& operator=(const InlineFunction&) = delete;
+
+		INLINE ~InlineFunction()noexcept
+		{
+			Reset();
+		}
+
+		INLINE R operator()(Args... args)const
+		{
+			VerifyNotNull(m_Invoke, "Trying to call an empty InlineFunction.");
+			return m_Invoke(const_cast<uint8*>(m_Storage), std::forward<Args>(args)...);
+		}
+
+		NODISCARD INLINE explicit operator bool()const noexcept { return m_Invoke != nullptr; }
+
+		NODISCARD INLINE bool IsInline()const noexcept { return m_IsInline; }
+
+		INLINE void Reset()noexcept
+		{
+			if (m_Manage != nullptr)
+				m_Manage(Operation::Destroy, m_Storage, nullptr);
+			m_Invoke = nullptr;
+			m_Manage = nullptr;
+			m_IsInline = true;
+		}
+
+		NODISCARD INLINE friend bool operator==(const InlineFunction& fn, std::nullptr_t)noexcept { return !fn; }
+		NODISCARD INLINE friend bool operator==(std::nullptr_t, const InlineFunction& fn)noexcept { return !fn; }
+		NODISCARD INLINE friend bool operator!=(const InlineFunction& fn, std::nullptr_t)noexcept { return (bool)fn; }
+		NODISCARD INLINE friend bool operator!=(std::nullptr_t, const InlineFunction& fn)noexcept { return (bool)fn; }
+
+	private:
+		alignas(std::max_align_t) uint8 m_Storage[InlineSize];
+		InvokeFn_t m_Invoke = nullptr;
+		ManageFn_t m_Manage = nullptr;
+		bool m_IsInline = true;
+
+		template<class F>
+		INLINE void Assign(F&& fn)noexcept
+		{
+			using Fn_t = std::decay_t<F>;
+
+			// Keep std::function and function pointer semantics, a null one gives an empty InlineFunction
+			if constexpr (std::is_pointer_v<Fn_t> || std::is_member_pointer_v<Fn_t> || Impl::IsStdFunction<Fn_t>::value)
+			{
+				if (fn == nullptr)
+					return;
+			}
+
+			if constexpr (FitsInline<Fn_t>)
+			{
+				new((void*)m_Storage)Fn_t(std::forward<F>(fn));
+				m_Invoke = [](void* storage, Args&&... args) -> R
+				{
+					return std::invoke(*static_cast<Fn_t*>(storage), std::forward<Args>(args)...);
+				};
+				m_Manage = [](Operation op, void* dst, void* src)
+				{
+					if (op == Operation::Move)
+					{
+						new(dst)Fn_t(std::move(*static_cast<Fn_t*>(src)));
+						static_cast<Fn_t*>(src)->~Fn_t();
+					}
+					else
+					{
+						static_cast<Fn_t*>(dst)->~Fn_t();
+					}
+				};
+				m_IsInline = true;
+			}
+			else
+			{
+				Fn_t* ptr = Construct<Fn_t>(std::forward<F>(fn));
+				new((void*)m_Storage)Fn_t*(ptr);
+				m_Invoke = [](void* storage, Args&&... args) -> R
+				{
+					return std::invoke(**static_cast<Fn_t**>(storage), std::forward<Args>(args)...);
+				};
+				m_Manage = [](Operation op, void* dst, void* src)
+				{
+					if (op == Operation::Move)
+						*static_cast<Fn_t**>(dst) = *static_cast<Fn_t**>(src);
+					else
+						Destroy(*static_cast<Fn_t**>(dst));
+				};
+				m_IsInline = false;
+			}
+		}
+
+		INLINE void MoveFrom(InlineFunction& other)noexcept
+		{
+			if (other.m_Manage == nullptr)
+				return;
+
+			other.m_Manage(Operation::Move, m_Storage, other.m_Storage);
+			m_Invoke = other.m_Invoke;
+			m_Manage = other.m_Manage;
+			m_IsInline = other.m_IsInline;
+			other.m_Invoke = nullptr;
+			other.m_Manage = nullptr;
+			other.m_IsInline = true;
+		}
+	};
+}
+
+#endif /* CORE_INLINE_FUNCTION_H */
@@ -0,0 +1,139 @@
+/***********************************************************************************
+*   Copyright 2022 Marcos Sánchez Torrent.                                         *
+*   All Rights Reserved.                                                           *
+***********************************************************************************/
+
+#pragma once
+
+#ifndef CORE_LATENCY_HISTOGRAM_H
+#define CORE_LATENCY_HISTOGRAM_H 1
+
+#include "../CorePrerequisites.h"
+
+namespace greaper
+{
+	/*** Lock-free histogram of durations
+	*
+	*	Durations are counted in nanoseconds on log-linear buckets, four per
+	*	power of two, so recording is just an atomic increment and percentiles
+	*	are approximated with less than 25% of error. Durations longer than
+	*	2^40ns (about 18 minutes) are counted on the last bucket.
+	*/
+	class LatencyHistogram
+	{
+	public:
+		LatencyHistogram()noexcept = default;
+
+		LatencyHistogram(const LatencyHistogram&) = delete;
+		LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+		void Record(Duration_t duration)noexcept;
+
+		NODISCARD uint64 GetCount()const noexcept;
+
+		/*** Returns the upper bound of the bucket holding the given percentile [0, 100] */
+		NODISCARD Duration_t GetPercentile(double percentile)const noexcept;
+
+		NODISCARD Duration_t GetMax()const noexcept;
+
+		void Reset()noexcept;
+
+	private:
+		static constexpr uint32 SubBucketBits = 2;
+		static constexpr uint32 SubBucketCount = 1u << SubBucketBits;
+		static constexpr uint32 MaxValueBits = 40;
+		static constexpr uint32 BucketCount = (MaxValueBits - SubBucketBits + 1) * SubBucketCount;
+
+		std::array<std::atomic<uint64>, BucketCount> m_Buckets{};
+		std::atomic<uint64> m_Max{ 0 };
+
+		static uint32 GetBucketIndex(uint64 nanos)noexcept;
+
+		static uint64 GetBucketUpperBound(uint32 index)noexcept;
+	};
+
+	INLINE void LatencyHistogram::Record(Duration_t duration) noexcept
+	{
+		const auto nanos = (uint64)Max((int64)std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(), (int64)0);
+		m_Buckets[GetBucketIndex(nanos)].fetch_add(1, std::memory_order_relaxed);
+
+		uint64 prevMax = m_Max.load(std::memory_order_relaxed);
+		while (prevMax < nanos && !m_Max.compare_exchange_weak(prevMax, nanos, std::memory_order_relaxed));
+	}
+
+	INLINE uint64 LatencyHistogram::GetCount() const noexcept
+	{
+		uint64 count = 0;
+		for (const auto& bucket : m_Buckets)
+			count += bucket.load(std::memory_order_relaxed);
+		return count;
+	}
+
+	inline Duration_t LatencyHistogram::GetPercentile(double percentile) const noexcept
+	{
+		// Take a snapshot so the total matches the buckets we iterate
+		std::array<uint64, BucketCount> buckets;
+		uint64 count = 0;
+		for (uint32 i = 0; i < BucketCount; ++i)
+		{
+			buckets[i] = m_Buckets[i].load(std::memory_order_relaxed);
+			count += buckets[i];
+		}
+		if (count == 0)
+			return Duration_t::zero();
+
+		const auto target = Max((uint64)((double)count * Clamp(percentile, 0.0, 100.0) / 100.0 + 0.5), (uint64)1);
+		uint64 accumulated = 0;
+		for (uint32 i = 0; i < BucketCount; ++i)
+		{
+			accumulated += buckets[i];
+			if (accumulated >= target)
+			{
+				const auto nanos = Min(GetBucketUpperBound(i), m_Max.load(std::memory_order_relaxed));
+				return std::chrono::duration_cast<Duration_t>(std::chrono::nanoseconds((int64)nanos));
+			}
+		}
+		return GetMax();
+	}
+
+	INLINE Duration_t LatencyHistogram::GetMax() const noexcept
+	{
+		return std::chrono::duration_cast<Duration_t>(std::chrono::nanoseconds((int64)m_Max.load(std::memory_order_relaxed)));
+	}
+
+	INLINE void LatencyHistogram::Reset() noexcept
+	{
+		for (auto& bucket : m_Buckets)
+			bucket.store(0, std::memory_order_relaxed);
+		m_Max.store(0, std::memory_order_relaxed);
+	}
+
+	INLINE uint32 LatencyHistogram::GetBucketIndex(uint64 nanos) noexcept
+	{
+		// The first buckets are exact
+		if (nanos < SubBucketCount)
+			return (uint32)nanos;
+
+		uint32 msb = FloorLog2(nanos);
+		if (msb >= MaxValueBits)
+		{
+			msb = MaxValueBits - 1;
+			nanos = (1ull << MaxValueBits) - 1;
+		}
+		const auto subBucket = (uint32)(nanos >> (msb - SubBucketBits)) & (SubBucketCount - 1);
+		return (msb - SubBucketBits + 1) * SubBucketCount + subBucket;
+	}
+
+	INLINE uint64 LatencyHistogram::GetBucketUpperBound(uint32 index) noexcept
+	{
+		if (index < SubBucketCount)
+			return index;
+
+		const uint32 msb = index / SubBucketCount - 1 + SubBucketBits;
+		const uint64 subBucket = index % SubBucketCount;
+		const uint64 bucketWidth = 1ull << (msb - SubBucketBits);
+		return (SubBucketCount + subBucket) * bucketWidth + bucketWidth - 1;
+	}
+}
+
+#endif /* CORE_LATENCY_HISTOGRAM_H */
@@ -11,30 +11,263 @@ namespace greaper
 {
 	namespace Impl
 	{
-		INLINE HTask::HTask(WPtr<Task> task, WPtr<MPMCTaskScheduler> scheduler)noexcept
-			:m_Task(std::move(task))
-			, m_Scheduler(std::move(scheduler))
+		INLINE HTask::HTask(Task* task, uint32 generation, WPtr<MPMCTaskScheduler> scheduler)noexcept
+			:m_Scheduler(std::move(scheduler))
+			, m_Task(task)
+			, m_Generation(generation)
 		{
 
 		}
 
-		INLINE TaskState_t Task::GetCurrentState()const noexcept { return m_State; }
+		INLINE TaskState_t Task::GetCurrentState()const noexcept { return m_State.load(); }
+
+		INLINE void Task::Complete(TaskState_t finalState)noexcept
+		{
+			m_State.store(finalState);
+			// Under the lock, so a continuation is either stored before or sees the new generation
+			m_ContinuationsLock.lock();
+			if (finalState == TaskState_t::Cancelled)
+				m_CancelledGeneration.store(m_Generation.load());
+			m_Generation.fetch_add(1);
+			m_ContinuationsLock.unlock();
+			if (m_Waiters.load() > 0)
+				AtomicNotifyAll(m_Generation);
+
+			// No one can add more until the task is reused, which happens after we return
+			for (auto& continuation : m_Continuations)
+				continuation();
+			m_Continuations.clear();
+		}
 
 		INLINE void HTask::WaitUntilFinish()noexcept
 		{
-			if (m_Task.expired() || m_Scheduler.expired())
+			if (IsFinished() || m_Scheduler.expired())
 				return;
 
 			auto scheduler = m_Scheduler.lock();
 			scheduler->WaitUntilTaskIsFinish(*this);
 		}
+
+		INLINE bool HTask::IsFinished()const noexcept
+		{
+			return m_Task == nullptr || m_Scheduler.expired() || m_Task->m_Generation.load() != m_Generation;
+		}
+
+		INLINE TaskState_t HTask::GetState()const noexcept
+		{
+			if (m_Task == nullptr || m_Scheduler.expired())
+				return TaskState_t::Completed;
+
+			// Loaded before checking the generation, so it belongs to our use of the task
+			const auto state = m_Task->m_State.load();
+			if (m_Task->m_Generation.load() == m_Generation)
+				return state;
+			return m_Task->m_CancelledGeneration.load() == m_Generation ? TaskState_t::Cancelled : TaskState_t::Completed;
+		}
+
+		INLINE bool HTask::Cancel()noexcept
+		{
+			if (IsFinished())
+				return false;
+
+			auto scheduler = m_Scheduler.lock();
+			return scheduler->CancelTask(*this);
+		}
+
+		INLINE CancellationToken HTask::GetCancellationToken()const noexcept
+		{
+			return CancellationToken{ m_Task, m_Generation, m_Scheduler };
+		}
+
+		INLINE bool HTask::AddContinuation(TaskFunction fn)noexcept
+		{
+			if (fn == nullptr || IsFinished())
+				return false;
+
+			m_Task->m_ContinuationsLock.lock();
+			const bool pending = m_Task->m_Generation.load() == m_Generation;
+			if (pending)
+				m_Task->m_Continuations.push_back(std::move(fn));
+			m_Task->m_ContinuationsLock.unlock();
+			return pending;
+		}
+
+		INLINE CancellationToken::CancellationToken(Task* task, uint32 generation, WTaskScheduler scheduler)noexcept
+			:m_Scheduler(std::move(scheduler))
+			, m_Task(task)
+			, m_Generation(generation)
+		{
+
+		}
+
+		INLINE bool CancellationToken::IsCancellationRequested()const noexcept
+		{
+			if (m_Task == nullptr || m_Scheduler.expired())
+				return false;
+
+			const bool requested = m_Task->m_CancelRequested.load(std::memory_order_relaxed) || m_Task->m_State.load(std::memory_order_relaxed) == TaskState_t::Cancelled;
+			if (m_Task->m_Generation.load() == m_Generation)
+				return requested;
+			return m_Task->m_CancelledGeneration.load() == m_Generation;
+		}
+
+		INLINE HTimer::HTimer(Timer* timer, uint32 generation, WTaskScheduler scheduler)noexcept
+			:m_Scheduler(std::move(scheduler))
+			, m_Timer(timer)
+			, m_Generation(generation)
+		{
+
+		}
+
+		INLINE bool HTimer::Cancel()noexcept
+		{
+			if (m_Timer == nullptr || m_Scheduler.expired())
+				return false;
+
+			auto scheduler = m_Scheduler.lock();
+			return scheduler->CancelTimer(*this);
+		}
+
+		INLINE bool HTimer::IsActive()const noexcept
+		{
+			if (m_Timer == nullptr || m_Scheduler.expired())
+				return false;
+
+			auto scheduler = m_Scheduler.lock();
+			return scheduler->IsTimerActive(*this);
+		}
+
+		INLINE bool TaskRing::IsEmpty()const noexcept { return m_Size == 0; }
+
+		INLINE sizet TaskRing::GetSize()const noexcept { return m_Size; }
+
+		INLINE void TaskRing::PushBack(Task* task)noexcept
+		{
+			if (m_Size == m_Buffer.size())
+				Grow();
+			m_Buffer[(m_Head + m_Size) & (m_Buffer.size() - 1)] = task;
+			++m_Size;
+		}
+
+		INLINE void TaskRing::Reserve()noexcept
+		{
+			if (m_Buffer.empty())
+				Grow();
+		}
+
+		INLINE Task* TaskRing::PeekFront()const noexcept
+		{
+			return m_Size == 0 ? nullptr : m_Buffer[m_Head];
+		}
+
+		INLINE Task* TaskRing::PopFront()noexcept
+		{
+			if (m_Size == 0)
+				return nullptr;
+			Task* task = m_Buffer[m_Head];
+			m_Head = (m_Head + 1) & (m_Buffer.size() - 1);
+			--m_Size;
+			return task;
+		}
+
+		INLINE Task* TaskRing::PopBack()noexcept
+		{
+			if (m_Size == 0)
+				return nullptr;
+			--m_Size;
+			return m_Buffer[(m_Head + m_Size) & (m_Buffer.size() - 1)];
+		}
+
+		inline void TaskRing::Grow()noexcept
+		{
+			// Capacity is kept as a power of two so indices can be masked
+			Vector<Task*> buffer;
+			buffer.resize(m_Buffer.empty() ? InitialCapacity : m_Buffer.size() * 2, nullptr);
+			for (sizet i = 0; i < m_Size; ++i)
+				buffer[i] = m_Buffer[(m_Head + i) & (m_Buffer.size() - 1)];
+			m_Buffer = std::move(buffer);
+			m_Head = 0;
+		}
+
+		INLINE bool TaskLanes::IsEmpty()const noexcept { return m_Size == 0; }
+
+		INLINE sizet TaskLanes::GetSize()const noexcept { return m_Size; }
+
+		INLINE void TaskLanes::Push(Task* task)noexcept
+		{
+			++m_Size;
+			if (task->m_Deadline != Timepoint_t::max())
+			{
+				m_DeadlineTasks.push_back(task);
+				std::push_heap(m_DeadlineTasks.begin(), m_DeadlineTasks.end(), &HasLaterDeadline);
+				return;
+			}
+			m_Lanes[task->m_Priority].PushBack(task);
+		}
+
+		INLINE void TaskLanes::Reserve()noexcept
+		{
+			for (auto& lane : m_Lanes)
+				lane.Reserve();
+		}
+
+		inline Task* TaskLanes::Pop(Timepoint_t now, bool newestFirst)noexcept
+		{
+			if (m_Size == 0)
+				return nullptr;
+
+			// Deadline about to be missed
+			if (!m_DeadlineTasks.empty() && m_DeadlineTasks.front()->m_Deadline - DeadlineSlack <= now)
+				return PopDeadline();
+
+			// Starvation avoidance, the oldest task of a lower lane has waited too much
+			for (sizet lane = TaskPriority_t::High + 1; lane < TaskPriority_t::COUNT; ++lane)
+			{
+				const auto* oldest = m_Lanes[lane].PeekFront();
+				if (oldest != nullptr && oldest->m_EnqueueTime + AgingLimits[lane] <= now)
+					return PopLane(lane, false);
+			}
+
+			if (!m_Lanes[TaskPriority_t::High].IsEmpty())
+				return PopLane(TaskPriority_t::High, newestFirst);
+
+			if (!m_DeadlineTasks.empty())
+				return PopDeadline();
+
+			for (sizet lane = TaskPriority_t::High + 1; lane < TaskPriority_t::COUNT; ++lane)
+			{
+				if (!m_Lanes[lane].IsEmpty())
+					return PopLane(lane, newestFirst);
+			}
+			return nullptr;
+		}
+
+		INLINE Task* TaskLanes::PopLane(sizet lane, bool newestFirst)noexcept
+		{
+			--m_Size;
+			return newestFirst ? m_Lanes[lane].PopBack() : m_Lanes[lane].PopFront();
+		}
+
+		INLINE Task* TaskLanes::PopDeadline()noexcept
+		{
+			--m_Size;
+			std::pop_heap(m_DeadlineTasks.begin(), m_DeadlineTasks.end(), &HasLaterDeadline);
+			Task* task = m_DeadlineTasks.back();
+			m_DeadlineTasks.pop_back();
+			return task;
+		}
+
+		INLINE bool TaskLanes::HasLaterDeadline(const Task* left, const Task* right)noexcept
+		{
+			return left->m_Deadline > right->m_Deadline;
+		}
 	}
 	
 	template<class _Alloc_>
-	INLINE SPtr<MPMCTaskScheduler> MPMCTaskScheduler::Create(WThreadManager threadMgr, StringView name, sizet workerCount, bool allowGrowth) noexcept
+	INLINE SPtr<MPMCTaskScheduler> MPMCTaskScheduler::Create(WThreadManager threadMgr, StringView name, sizet workerCount, bool allowGrowth, TaskSchedulerMode_t mode, bool pinWorkers) noexcept
 	{
 		auto* ptr = AllocT<MPMCTaskScheduler, _Alloc_>();
-		new ((void*)ptr)MPMCTaskScheduler(threadMgr, std::move(name), workerCount, allowGrowth);
+		new ((void*)ptr)MPMCTaskScheduler(threadMgr, std::move(name), workerCount, allowGrowth, mode, pinWorkers);
 		return SPtr<MPMCTaskScheduler>((MPMCTaskScheduler*)ptr, &Impl::DefaultDeleter<MPMCTaskScheduler, _Alloc_>);
 	}
 
@@ -48,105 +281,293 @@ namespace greaper
 
 	inline EmptyResult MPMCTaskScheduler::SetWorkerCount(sizet count) noexcept
 	{
-		m_TaskWorkersMutex.lock();
-		if (m_TaskWorkers.size() == count)
 		{
-			m_TaskWorkersMutex.unlock();
-			return Result::CreateSuccess();
+			LOCK(m_TaskWorkersMutex);
+			if (m_TaskWorkers.size() < count)
+				return AddWorkers(count);
+
+			// Removed workers leave by themselves once they finish their current task
+			while (m_TaskWorkers.size() > count)
+				RemoveLastWorker();
 		}
-		// Add new workers
-		if (m_TaskWorkers.size() < count)
+		WakeAllWorkers();
+		JoinRetiredWorkers();
+		return Result::CreateSuccess();
+	}
+
+	INLINE TResult<Impl::HTask> MPMCTaskScheduler::AddTask(StringView name, TaskFunction workFn, TaskPriority_t priority) noexcept
+	{
+		return AddTask(name, std::move(workFn), priority, Timepoint_t::max());
+	}
+
+	inline TResult<Impl::HTask> MPMCTaskScheduler::AddTask(StringView name, TaskFunction workFn, TaskPriority_t priority, Timepoint_t deadline) noexcept
+	{
+		if (priority >= TaskPriority_t::COUNT)
 		{
-			auto lck = Lock<decltype(m_TaskWorkersMutex)>(m_TaskWorkersMutex, AdoptLock{});
-			
-			if(!m_AllowGrowth)
-				return Result::CreateFailure("Trying to add more workers to a MPMCTaskScheduler, but it has forbidden the growth."sv);
+			return Result::CreateFailure<Impl::HTask>(
+				Format("Couldn't add the task '%s', invalid priority.", name.data()));
+		}
 
-			if (m_ThreadManager.expired())
-				return Result::CreateFailure("Trying to add more workers to a MPMCTaskScheduler, but the ThreadManager has expired."sv);
+		auto wkLck = SharedLock(m_TaskWorkersMutex); // we keep the lock so if there's only 1 task worker and someone wants to remove it, we can still schedule this task
+		if (!AreThereAnyAvailableWorker())
+		{
+			return Result::CreateFailure<Impl::HTask>(
+				Format("Couldn't add the task '%s', no available workers.", name.data()));
+		}
+
+		Impl::Task* taskPtr = AcquireTask();
+		taskPtr->m_Name.assign(name);
+		taskPtr->m_State = TaskState_t::Inactive;
+		taskPtr->m_WorkFn = std::move(workFn);
+		taskPtr->m_Priority = priority;
+		taskPtr->m_Deadline = deadline;
+
+		Impl::HTask hTask{ taskPtr, taskPtr->m_Generation.load(), (WPtr<MPMCTaskScheduler>)m_This };
+
+		PushTask(taskPtr);
+		
+		return Result::CreateSuccess(hTask);
+	}
+
+	inline TResult<Impl::HTask> MPMCTaskScheduler::AddDelayedTask(StringView name, TaskFunction workFn, Duration_t delay, TaskPriority_t priority) noexcept
+	{
+		if (priority >= TaskPriority_t::COUNT)
+		{
+			return Result::CreateFailure<Impl::HTask>(
+				Format("Couldn't add the delayed task '%s', invalid priority.", name.data()));
+		}
 
-			auto thManager = m_ThreadManager.lock();
-			for (sizet i = m_TaskWorkers.size(); i < count; ++i)
+		{
+			auto wkLck = SharedLock(m_TaskWorkersMutex);
+			if (!AreThereAnyAvailableWorker())
 			{
-				ThreadConfig cfg;
-				auto name = Format("%s_%" PRIuPTR "", m_Name.c_str(), i);
-				cfg.Name = name;
-				cfg.ThreadFN = [this, i]() { WorkerFn(*this, i); };
-				auto thRes = thManager->CreateThread(cfg);
-				if (thRes.HasFailed())
-					return Result::CopyFailure(thRes);
-				m_TaskWorkers.push_back(thRes.GetValue());
+				return Result::CreateFailure<Impl::HTask>(
+					Format("Couldn't add the delayed task '%s', no available workers.", name.data()));
 			}
 		}
-		// Remove workers
-		else
+
+		const auto dueTick = GetTimerTick(Clock_t::now() + Max(delay, Duration_t::zero()), true);
+		bool wakeTimer;
+		Impl::HTask hTask;
 		{
-			while (m_TaskWorkers.size() > count)
+			LOCK(m_TimerMutex);
+			if (m_TimerStopped)
 			{
-				const auto sz = m_TaskWorkers.size();
-				PThread th = m_TaskWorkers[sz - 1];
-				m_TaskWorkers[sz - 1].reset();
-				m_TaskWorkersMutex.unlock();
-				while (th != nullptr)
-				{
-					if (th->TryJoin())
-					{
-						th.reset();
-					}
-					else
-					{
-						m_TaskQueueSignal.notify_all();
-						THREAD_YIELD();
-					}
-				}
-				m_TaskQueueMutex.lock();
-				m_TaskWorkers.erase(m_TaskWorkers.begin() + (sz - 1));
+				return Result::CreateFailure<Impl::HTask>(
+					Format("Couldn't add the delayed task '%s', the MPMCTaskScheduler is stopping.", name.data()));
 			}
+
+			const auto startRes = StartTimerThread();
+			if (startRes.HasFailed())
+				return Result::CopyFailure<Impl::HTask>(startRes);
+
+			Impl::Task* taskPtr = AcquireTask();
+			taskPtr->m_Name.assign(name);
+			taskPtr->m_State = TaskState_t::Inactive;
+			taskPtr->m_WorkFn = std::move(workFn);
+			taskPtr->m_Priority = priority;
+			taskPtr->m_Deadline = Timepoint_t::max();
+			hTask = Impl::HTask{ taskPtr, taskPtr->m_Generation.load(), (WPtr<MPMCTaskScheduler>)m_This };
+
+			auto* timer = AcquireTimer();
+			timer->TaskPtr = taskPtr;
+			wakeTimer = ArmTimer(timer, dueTick);
 		}
-		return Result::CreateSuccess();
+		// The timer only has to recompute its sleep if this one goes first
+		if (wakeTimer)
+			m_TimerSignal.notify_one();
+
+		return Result::CreateSuccess(hTask);
 	}
 
-	inline TResult<Impl::HTask> MPMCTaskScheduler::AddTask(StringView name, std::function<void()> workFn) noexcept
+	inline TResult<Impl::HTimer> MPMCTaskScheduler::AddTimer(StringView name, TaskFunction fn, Duration_t delay, Duration_t period, Duration_t slack, TaskPriority_t priority) noexcept
 	{
-		auto wkLck = SharedLock(m_TaskWorkersMutex); // we keep the lock so if there's only 1 task worker and someone wants to remove it, we can still schedule this task
-		if (!AreThereAnyAvailableWorker())
+		if (priority >= TaskPriority_t::COUNT)
 		{
-			return Result::CreateFailure<Impl::HTask>(
-				Format("Couldn't add the task '%s', no available workers.", name.data()));
+			return Result::CreateFailure<Impl::HTimer>(
+				Format("Couldn't add the timer '%s', invalid priority.", name.data()));
+		}
+		if (fn == nullptr)
+		{
+			return Result::CreateFailure<Impl::HTimer>(
+				Format("Couldn't add the timer '%s', no function was given.", name.data()));
+		}
+		if (period < Duration_t::zero() || slack < Duration_t::zero())
+		{
+			return Result::CreateFailure<Impl::HTimer>(
+				Format("Couldn't add the timer '%s', negative period or slack.", name.data()));
 		}
 
-		Impl::Task* taskPtr;
 		{
-			auto fpLck = Lock(m_FreeTaskPoolMutex);
-			if (m_FreeTaskPool.empty())
+			auto wkLck = SharedLock(m_TaskWorkersMutex);
+			if (!AreThereAnyAvailableWorker())
 			{
-				taskPtr = Construct<Impl::Task>();
+				return Result::CreateFailure<Impl::HTimer>(
+					Format("Couldn't add the timer '%s', no available workers.", name.data()));
 			}
-			else
+		}
+
+		const auto dueTick = GetTimerTick(Clock_t::now() + Max(delay, Duration_t::zero()), true);
+		bool wakeTimer;
+		Impl::HTimer hTimer;
+		{
+			LOCK(m_TimerMutex);
+			if (m_TimerStopped)
 			{
-				taskPtr = m_FreeTaskPool.back();
-				m_FreeTaskPool.pop_back();
+				return Result::CreateFailure<Impl::HTimer>(
+					Format("Couldn't add the timer '%s', the MPMCTaskScheduler is stopping.", name.data()));
 			}
+
+			const auto startRes = StartTimerThread();
+			if (startRes.HasFailed())
+				return Result::CopyFailure<Impl::HTimer>(startRes);
+
+			auto* timer = AcquireTimer();
+			timer->Name.assign(name);
+			timer->Callback = std::move(fn);
+			timer->Priority = priority;
+			// A period shorter than a tick would fire on every tick anyway
+			timer->PeriodTicks = period == Duration_t::zero() ? 0 : Max(DivideAndRoundUp<uint64>(std::chrono::ceil<std::chrono::milliseconds>(period).count(), TimerResolution.count()), (uint64)1);
+			timer->SlackTicks = std::chrono::duration_cast<std::chrono::milliseconds>(slack).count() / TimerResolution.count();
+			hTimer = Impl::HTimer{ timer, timer->Generation, (WPtr<MPMCTaskScheduler>)m_This };
+			wakeTimer = ArmTimer(timer, dueTick);
 		}
-		taskPtr->m_Name.assign(name);
-		taskPtr->m_State = TaskState_t::Inactive;
-		taskPtr->m_WorkFn = std::move(workFn);
-		SPtr<Impl::Task> task{ taskPtr , &Impl::EmptyDeleter<Impl::Task> };
+		if (wakeTimer)
+			m_TimerSignal.notify_one();
 
-		Impl::HTask hTask;
-		hTask.m_Scheduler = (WPtr<MPMCTaskScheduler>)m_This;
-		hTask.m_Task = (WPtr<Impl::Task>)task;
+		return Result::CreateSuccess(hTimer);
+	}
 
-		m_TaskQueueMutex.lock();
-		m_TaskQueue.push_back(task);
-		m_TaskQueueMutex.unlock();
-		m_TaskQueueSignal.notify_one();
-		
-		return Result::CreateSuccess(hTask);
+	inline bool MPMCTaskScheduler::CancelTimer(const Impl::HTimer& hTimer) noexcept
+	{
+		if (hTimer.m_Timer == nullptr || hTimer.m_Scheduler.lock() != m_This)
+			return false;
+
+		TaskFunction callback;
+		{
+			LOCK(m_TimerMutex);
+			auto* timer = hTimer.m_Timer;
+			if (timer->Generation != hTimer.m_Generation || timer->Cancelled)
+				return false;
+
+			// Released by RunTimer once it returns
+			if (timer->Running)
+			{
+				timer->Cancelled = true;
+				return true;
+			}
+			m_TimerWheel.Remove(timer);
+			ReleaseTimer(timer, callback);
+		}
+		// Its captures are released here, without the lock
+		return true;
+	}
+
+	INLINE bool MPMCTaskScheduler::IsTimerActive(const Impl::HTimer& hTimer) const noexcept
+	{
+		if (hTimer.m_Timer == nullptr || hTimer.m_Scheduler.lock() != m_This)
+			return false;
+
+		LOCK(m_TimerMutex);
+		return hTimer.m_Timer->Generation == hTimer.m_Generation && !hTimer.m_Timer->Cancelled;
+	}
+
+	inline EmptyResult MPMCTaskScheduler::SetScaling(const TaskSchedulerScaling& scaling) noexcept
+	{
+		if (scaling.MinWorkers == 0 || scaling.MinWorkers > scaling.MaxWorkers)
+			return Result::CreateFailure(Format("Trying to set an invalid worker range [%" PRIuPTR ", %" PRIuPTR "] to the MPMCTaskScheduler '%s'.", scaling.MinWorkers, scaling.MaxWorkers, m_Name.c_str()));
+		if (m_Mode == TaskSchedulerMode_t::WorkStealing && scaling.MaxWorkers > MaxStealingWorkers)
+			return Result::CreateFailure(Format("Trying to set more workers to the WorkStealing MPMCTaskScheduler '%s' than its limit %" PRIuPTR ".", m_Name.c_str(), MaxStealingWorkers));
+		if (scaling.ScaleUpLatency <= Duration_t::zero() || scaling.IdleTimeout <= Duration_t::zero())
+			return Result::CreateFailure(Format("Trying to set a scaling policy without latency or idle timeout to the MPMCTaskScheduler '%s'.", m_Name.c_str()));
+
+		m_MinWorkers.store(scaling.MinWorkers);
+		m_MaxWorkers.store(scaling.MaxWorkers);
+		m_ScaleUpLatency.store(scaling.ScaleUpLatency.count());
+		m_IdleTimeout.store(scaling.IdleTimeout.count());
+		m_AutoScale.store(scaling.Enabled);
+
+		// Idle workers may be waiting without timeout, or with the old one
+		WakeAllWorkers();
+
+		if (!scaling.Enabled)
+			return Result::CreateSuccess();
+
+		const auto count = GetWorkerCount();
+		if (count < scaling.MinWorkers)
+			return SetWorkerCount(scaling.MinWorkers);
+		if (count > scaling.MaxWorkers)
+			return SetWorkerCount(scaling.MaxWorkers);
+		return Result::CreateSuccess();
+	}
+
+	INLINE TaskSchedulerScaling MPMCTaskScheduler::GetScaling() const noexcept
+	{
+		TaskSchedulerScaling scaling;
+		scaling.Enabled = m_AutoScale.load();
+		scaling.MinWorkers = m_MinWorkers.load();
+		scaling.MaxWorkers = m_MaxWorkers.load();
+		scaling.ScaleUpLatency = Duration_t(m_ScaleUpLatency.load());
+		scaling.IdleTimeout = Duration_t(m_IdleTimeout.load());
+		return scaling;
+	}
+
+	inline EmptyResult MPMCTaskScheduler::InitScalingProperties() noexcept
+	{
+		if (m_ThreadManager.expired())
+			return Result::CreateFailure(Format("Trying to create the scaling properties of the MPMCTaskScheduler '%s', but the ThreadManager has expired.", m_Name.c_str()));
+
+		auto library = m_ThreadManager.lock()->GetLibrary().lock();
+		if (library == nullptr)
+			return Result::CreateFailure(Format("Trying to create the scaling properties of the MPMCTaskScheduler '%s', but the ThreadManager has no library.", m_Name.c_str()));
+
+		const auto scaling = GetScaling();
+		auto autoScaleRes = GetOrCreateProperty<bool>(library, Format("%s_AutoScale", m_Name.c_str()), scaling.Enabled,
+			"Enables the auto-scaling of the scheduler workers."sv);
+		if (autoScaleRes.HasFailed())
+			return Result::CopyFailure(autoScaleRes);
+		auto minWorkersRes = GetOrCreateProperty<uint32>(library, Format("%s_MinWorkers", m_Name.c_str()), (uint32)scaling.MinWorkers,
+			"Workers kept while auto-scaling."sv);
+		if (minWorkersRes.HasFailed())
+			return Result::CopyFailure(minWorkersRes);
+		auto maxWorkersRes = GetOrCreateProperty<uint32>(library, Format("%s_MaxWorkers", m_Name.c_str()), (uint32)scaling.MaxWorkers,
+			"Maximum workers while auto-scaling."sv);
+		if (maxWorkersRes.HasFailed())
+			return Result::CopyFailure(maxWorkersRes);
+		auto latencyRes = GetOrCreateProperty<uint32>(library, Format("%s_ScaleUpLatencyUs", m_Name.c_str()),
+			(uint32)std::chrono::duration_cast<std::chrono::microseconds>(scaling.ScaleUpLatency).count(),
+			"Queue latency, in microseconds, from which a worker is added."sv);
+		if (latencyRes.HasFailed())
+			return Result::CopyFailure(latencyRes);
+		auto idleTimeoutRes = GetOrCreateProperty<uint32>(library, Format("%s_IdleTimeoutMs", m_Name.c_str()),
+			(uint32)std::chrono::duration_cast<std::chrono::milliseconds>(scaling.IdleTimeout).count(),
+			"Time, in milliseconds, that a worker stays idle before retiring."sv);
+		if (idleTimeoutRes.HasFailed())
+			return Result::CopyFailure(idleTimeoutRes);
+
+		m_ScalingProps[AutoScaleProp] = (WIProperty)autoScaleRes.GetValue();
+		m_ScalingProps[MinWorkersProp] = (WIProperty)minWorkersRes.GetValue();
+		m_ScalingProps[MaxWorkersProp] = (WIProperty)maxWorkersRes.GetValue();
+		m_ScalingProps[ScaleUpLatencyProp] = (WIProperty)latencyRes.GetValue();
+		m_ScalingProps[IdleTimeoutProp] = (WIProperty)idleTimeoutRes.GetValue();
+		for (sizet i = 0; i < ScalingPropCount; ++i)
+		{
+			auto prop = m_ScalingProps[i].lock();
+			m_OnScalingPropChanged[i].Disconnect();
+			prop->GetOnModificationEvent().Connect(m_OnScalingPropChanged[i], [this](UNUSED IProperty* prop) { OnScalingPropertyChanged(); });
+		}
+
+		// Reused properties may hold other values
+		OnScalingPropertyChanged();
+		return Result::CreateSuccess();
 	}
 
-	inline TResult<Vector<Impl::HTask>> MPMCTaskScheduler::AddTasks(const Vector<std::tuple<StringView, std::function<void()>>>& tasks) noexcept
+	inline TResult<Vector<Impl::HTask>> MPMCTaskScheduler::AddTasks(const Vector<std::tuple<StringView, std::function<void()>>>& tasks, TaskPriority_t priority) noexcept
 	{
+		if (priority >= TaskPriority_t::COUNT)
+		{
+			return Result::CreateFailure<Vector<Impl::HTask>>("Couldn't add multiple tasks, invalid priority."sv);
+		}
 		if(tasks.empty())
 		{
 			return Result::CreateFailure<Vector<Impl::HTask>>("Trying to add multiple tasks, but an empty task vector was given."sv);
@@ -159,66 +580,96 @@ namespace greaper
 			return Result::CreateFailure<Vector<Impl::HTask>>("Couldn't add multiple tasks, no available workers."sv);
 		}
 
-		Vector<SPtr<Impl::Task>> taskPtrs;
+		Vector<Impl::Task*> taskPtrs;
+		AcquireTasks(tasks.size(), taskPtrs);
+
 		Vector<Impl::HTask> hTasks;
-		taskPtrs.reserve(tasks.size());
 		hTasks.reserve(tasks.size());
-		while(taskPtrs.size() < tasks.size())
+		const auto wThis = (WPtr<MPMCTaskScheduler>)m_This;
+		for (sizet i = 0; i < tasks.size(); ++i)
 		{
-			Impl::Task* taskPtr;
-			{
-				auto fpLck = Lock(m_FreeTaskPoolMutex);
-				if (m_FreeTaskPool.empty())
-				{
-					taskPtr = Construct<Impl::Task>();
-				}
-				else
-				{
-					taskPtr = m_FreeTaskPool.back();
-					m_FreeTaskPool.pop_back();
-				}
-			}
-			auto& tuple = tasks[taskPtrs.size()];
+			Impl::Task* taskPtr = taskPtrs[i];
+			const auto& tuple = tasks[i];
 			taskPtr->m_Name.assign(std::get<0>(tuple));
 			taskPtr->m_State = TaskState_t::Inactive;
 			taskPtr->m_WorkFn = std::get<1>(tuple);
-			auto task = SPtr<Impl::Task>{ taskPtr };
-			hTasks.push_back(Impl::HTask{ (WPtr<Impl::Task>)task, (WPtr<MPMCTaskScheduler>)m_This });
-			taskPtrs.push_back(task);
+			taskPtr->m_Priority = priority;
+			taskPtr->m_Deadline = Timepoint_t::max();
+			hTasks.push_back(Impl::HTask{ taskPtr, taskPtr->m_Generation.load(), wThis });
 		}
 
-		m_TaskQueueMutex.lock();
-		const auto oldSize = m_TaskQueue.size();
-		std::move(taskPtrs.begin(), taskPtrs.end(), m_TaskQueue.begin() + oldSize);
-		m_TaskQueueMutex.unlock();
-		for(std::size_t i = 0; i < tasks.size(); ++i)
-			m_TaskQueueSignal.notify_one();
+		PushTasks(taskPtrs);
 
 		return Result::CreateSuccess(hTasks);
 	}
 
 	INLINE void MPMCTaskScheduler::WaitUntilTaskIsFinish(const Impl::HTask& hTask) noexcept
 	{
-		if (hTask.m_Scheduler.expired() || hTask.m_Task.expired())
+		if (hTask.IsFinished())
 			return;
 		if (hTask.m_Scheduler.lock() != m_This)
 			return;
-		auto task = hTask.m_Task.lock();
 
-		auto lck = UniqueLock<decltype(m_TaskQueueMutex)>(m_TaskQueueMutex);
-		while (Contains(m_TaskQueue, task))
-			m_TaskQueueSignal.wait(lck);
+		// Tasks are pooled until the scheduler stops, so we can sleep on the task generation,
+		// which changes once the task has completed, without looking at the queues
+		auto* task = hTask.m_Task;
+		task->m_Waiters.fetch_add(1);
+		AtomicWait(task->m_Generation, hTask.m_Generation);
+		task->m_Waiters.fetch_sub(1);
 	}
 
-	INLINE void MPMCTaskScheduler::WaitUntilAllTasksFinished() noexcept
+	inline bool MPMCTaskScheduler::CancelTask(const Impl::HTask& hTask) noexcept
 	{
-		// Don't add more tasks nor change the amount of workers
-		auto wkLck = Lock(m_TaskWorkersMutex);
+		if (hTask.IsFinished())
+			return false;
+		if (hTask.m_Scheduler.lock() != m_This)
+			return false;
+
+		auto* task = hTask.m_Task;
+		task->m_ContinuationsLock.lock();
+		if (task->m_Generation.load() != hTask.m_Generation)
+		{
+			task->m_ContinuationsLock.unlock();
+			return false;
+		}
+		auto expected = TaskState_t::Inactive;
+		if (!task->m_State.compare_exchange_strong(expected, TaskState_t::Cancelled))
+		{
+			// Already running, only its body can stop it
+			task->m_CancelRequested.store(true);
+			task->m_ContinuationsLock.unlock();
+			return false;
+		}
+		task->m_ContinuationsLock.unlock();
 
-		// Wait until no more tasks
-		auto lck = UniqueLock<decltype(m_TaskQueueMutex)>(m_TaskQueueMutex);
-		while (!m_TaskQueue.empty())
-			m_TaskQueueSignal.wait(lck);
+		// Whoever pops it won't touch it anymore, so we can release its captures and wake its waiters now
+		m_LaneCounters[task->m_Priority].CancelledTasks.fetch_add(1, std::memory_order_relaxed);
+		task->m_WorkFn = nullptr;
+		task->Complete(TaskState_t::Cancelled);
+		if (ReleaseCancelledTask(task))
+			RecycleTask(task);
+		return true;
+	}
+
+	INLINE Impl::CancellationToken MPMCTaskScheduler::GetCurrentCancellationToken() noexcept
+	{
+		auto* task = tl_CurrentTask;
+		if (task == nullptr)
+			return Impl::CancellationToken{};
+		return Impl::CancellationToken{ task, task->m_Generation.load(), (WPtr<MPMCTaskScheduler>)tl_CurrentScheduler->m_This };
+	}
+
+	INLINE void MPMCTaskScheduler::WaitUntilAllTasksFinished() noexcept
+	{
+		// Wait until all the scheduled tasks have been executed, workers decrease the pending count
+		// once they have finished the task, so we cannot hold the workers mutex while waiting
+		m_FinishWaiters.fetch_add(1);
+		{
+			auto lck = UniqueLock<decltype(m_FinishedMutex)>(m_FinishedMutex);
+			while (m_PendingTasks.load() > 0)
+				m_FinishedSignal.wait(lck);
+		}
+		m_FinishWaiters.fetch_sub(1);
 	}
 
 	INLINE const String& MPMCTaskScheduler::GetName() const noexcept { return m_Name; }
@@ -235,6 +686,38 @@ namespace greaper
 		m_AllowGrowth = enable;
 	}
 
+	INLINE TaskSchedulerMode_t MPMCTaskScheduler::GetMode() const noexcept { return m_Mode; }
+
+	INLINE bool MPMCTaskScheduler::IsWorkerPinningEnabled() const noexcept { return m_PinWorkers; }
+
+	inline TaskSchedulerStats MPMCTaskScheduler::GetStats() const noexcept
+	{
+		TaskSchedulerStats stats;
+		for (sizet lane = 0; lane < TaskPriority_t::COUNT; ++lane)
+		{
+			const auto& counters = m_LaneCounters[lane];
+			auto& laneStats = stats.Lanes[lane];
+			laneStats.ExecutedTasks = counters.QueueLatency.GetCount();
+			laneStats.DeadlineMisses = counters.DeadlineMisses.load(std::memory_order_relaxed);
+			laneStats.CancelledTasks = counters.CancelledTasks.load(std::memory_order_relaxed);
+			laneStats.QueueLatencyP50 = counters.QueueLatency.GetPercentile(50.0);
+			laneStats.QueueLatencyP90 = counters.QueueLatency.GetPercentile(90.0);
+			laneStats.QueueLatencyP99 = counters.QueueLatency.GetPercentile(99.0);
+			laneStats.QueueLatencyMax = counters.QueueLatency.GetMax();
+		}
+		return stats;
+	}
+
+	INLINE void MPMCTaskScheduler::ResetStats() noexcept
+	{
+		for (auto& counters : m_LaneCounters)
+		{
+			counters.QueueLatency.Reset();
+			counters.DeadlineMisses.store(0, std::memory_order_relaxed);
+			counters.CancelledTasks.store(0, std::memory_order_relaxed);
+		}
+	}
+
 	INLINE void MPMCTaskScheduler::OnNewManager(const PInterface& newInterface) noexcept
 	{
 		auto lck = SharedLock(m_TaskWorkersMutex);
@@ -278,20 +761,50 @@ namespace greaper
 
 	INLINE void MPMCTaskScheduler::Stop() noexcept
 	{
+		// Before the workers, so due tasks still reach them
+		StopTimer();
+		m_AutoScale.store(false);
+		for (auto& handler : m_OnScalingPropChanged)
+			handler.Disconnect();
 		SetWorkerCount(0);
 		
-		for (auto& task : m_TaskQueue)
+		// Delayed tasks run in due order, timers are dropped
+		Vector<TimerWheelNode*> timerNodes;
+		m_TimerWheel.TakeAll(timerNodes);
+		std::sort(timerNodes.begin(), timerNodes.end(), [](const TimerWheelNode* left, const TimerWheelNode* right) { return left->DueTick < right->DueTick; });
+		for (auto* node : timerNodes)
 		{
-			task->m_State = TaskState_t::InProgress;
-			task->m_WorkFn();
-			task->m_State = TaskState_t::Completed;
-			Destroy(task.get());
+			auto* timer = static_cast<Impl::Timer*>(node);
+			if (timer->TaskPtr != nullptr)
+				RunAndDestroyTask(timer->TaskPtr);
+			m_FreeTimers.push_back(timer);
 		}
-		m_TaskQueue.clear();
+
+		const auto now = Clock_t::now();
+		while (auto* task = m_TaskQueue.Pop(now))
+			RunAndDestroyTask(task);
+		for (auto& queueAtomic : m_WorkQueues)
+		{
+			auto* queue = queueAtomic.exchange(nullptr);
+			if (queue == nullptr)
+				continue;
+			while (auto* task = queue->Tasks.Pop(now))
+				RunAndDestroyTask(task);
+			Destroy(queue);
+		}
+		m_WorkQueueCount.store(0);
+		m_QueuedTasks.store(0);
+		m_PendingTasks.store(0);
 		for (auto* task : m_FreeTaskPool)
 		{
 			Destroy(task);
 		}
+		// After the queues, as posted timers use them until they have run
+		for (auto* timer : m_FreeTimers)
+		{
+			Destroy(timer);
+		}
+		m_FreeTimers.clear();
 	}
 
 	INLINE bool MPMCTaskScheduler::AreThereAnyAvailableWorker() const noexcept
@@ -307,11 +820,14 @@ namespace greaper
 		return false; // There is no active worker
 	}
 
-	INLINE MPMCTaskScheduler::MPMCTaskScheduler(WThreadManager threadMgr, StringView name, sizet workerCount, bool allowGrowth)noexcept
+	INLINE MPMCTaskScheduler::MPMCTaskScheduler(WThreadManager threadMgr, StringView name, sizet workerCount, bool allowGrowth, TaskSchedulerMode_t mode, bool pinWorkers)noexcept
 		:m_ThreadManager(std::move(threadMgr))
 		,m_Name(name)
+		,m_TimerEpoch(Clock_t::now())
 		,m_This(this, &Impl::EmptyDeleter<MPMCTaskScheduler>)
 		,m_AllowGrowth(true)
+		,m_Mode(mode)
+		,m_PinWorkers(pinWorkers)
 	{
 		VerifyNot(m_ThreadManager.expired(), "Trying to initialize a MPMCTaskScheduler, but an expired ThreadManager was given.");
 		auto mgr = m_ThreadManager.lock();
@@ -321,27 +837,217 @@ namespace greaper
 		m_AllowGrowth = allowGrowth;
 	}
 
-	INLINE bool MPMCTaskScheduler::CanWorkerContinueWorking(sizet workerID)const noexcept
+	INLINE bool MPMCTaskScheduler::CanWorkerContinueWorking(sizet workerID, uint64 token)const noexcept
 	{
 		auto lck = SharedLock(m_TaskWorkersMutex);
-		return m_TaskWorkers.size() > workerID && m_TaskWorkers[workerID] != nullptr;
+		return m_WorkerTokens.size() > workerID && m_WorkerTokens[workerID] == token;
 	}
 
-	INLINE void MPMCTaskScheduler::WorkerFn(MPMCTaskScheduler& scheduler, sizet id) noexcept
+	inline EmptyResult MPMCTaskScheduler::AddWorkers(sizet count) noexcept
+	{
+		if (!m_AllowGrowth)
+			return Result::CreateFailure("Trying to add more workers to a MPMCTaskScheduler, but it has forbidden the growth."sv);
+
+		if (m_ThreadManager.expired())
+			return Result::CreateFailure("Trying to add more workers to a MPMCTaskScheduler, but the ThreadManager has expired."sv);
+
+		if (m_Mode == TaskSchedulerMode_t::WorkStealing && count > MaxStealingWorkers)
+			return Result::CreateFailure(Format("Trying to add more workers to a WorkStealing MPMCTaskScheduler than its limit %" PRIuPTR ".", MaxStealingWorkers));
+
+		auto thManager = m_ThreadManager.lock();
+		// The topology is only available once the library has been initialized
+		const auto& topology = OSPlatform::GetCPUTopology();
+		const sizet logicalCount = topology.LogicalCoreCount > 0 ? topology.LogicalCoreCount : std::thread::hardware_concurrency();
+		const sizet cpuCount = Clamp(logicalCount, (sizet)1, MaxThreadAffinityCPUs);
+		for (sizet i = m_TaskWorkers.size(); i < count; ++i)
+		{
+			const uint64 token = ++m_NextWorkerToken;
+			ThreadConfig cfg;
+			auto name = Format("%s_%" PRIuPTR "", m_Name.c_str(), i);
+			cfg.Name = name;
+			if (m_PinWorkers)
+				cfg.Affinity.set(i % cpuCount);
+			Impl::TaskWorkQueue* queue = nullptr;
+			if (m_Mode == TaskSchedulerMode_t::WorkStealing)
+			{
+				// Queues are never released until the scheduler is stopped, so thieves can keep
+				// iterating over them without locking, and retired queues can still be stolen from
+				queue = m_WorkQueues[i].load(std::memory_order_acquire);
+				// A pinned worker creates its own queue, see StealingWorkerFn
+				if (queue == nullptr && !m_PinWorkers)
+				{
+					queue = Construct<Impl::TaskWorkQueue>();
+					m_WorkQueues[i].store(queue, std::memory_order_release);
+					m_WorkQueueCount.store(i + 1, std::memory_order_release);
+				}
+				if (queue != nullptr)
+					queue->Owner.store(token, std::memory_order_release);
+				cfg.ThreadFN = [this, i, token]() { StealingWorkerFn(*this, i, token); };
+			}
+			else
+			{
+				cfg.ThreadFN = [this, i, token]() { WorkerFn(*this, i, token); };
+			}
+			auto thRes = thManager->CreateThread(cfg);
+			if (thRes.HasFailed())
+			{
+				if (queue != nullptr)
+					queue->Owner.store(0, std::memory_order_release);
+				return Result::CopyFailure(thRes);
+			}
+			if (m_Mode == TaskSchedulerMode_t::WorkStealing && queue == nullptr)
+			{
+				// The other queues are expected to exist up to the worker count
+				while (m_WorkQueues[i].load(std::memory_order_acquire) == nullptr)
+					THREAD_YIELD();
+				m_WorkQueueCount.store(i + 1, std::memory_order_release);
+			}
+			m_TaskWorkers.push_back(thRes.GetValue());
+			m_WorkerTokens.push_back(token);
+		}
+		return Result::CreateSuccess();
+	}
+
+	INLINE void MPMCTaskScheduler::RemoveLastWorker() noexcept
+	{
+		const auto id = m_TaskWorkers.size() - 1;
+		m_RetiredWorkers.push_back(std::move(m_TaskWorkers[id]));
+		m_TaskWorkers.pop_back();
+		m_WorkerTokens.pop_back();
+		if (m_Mode == TaskSchedulerMode_t::WorkStealing)
+			m_WorkQueues[id].load(std::memory_order_acquire)->Owner.store(0, std::memory_order_release);
+	}
+
+	INLINE bool MPMCTaskScheduler::TryRetireWorker(sizet workerID, uint64 token) noexcept
+	{
+		LOCK(m_TaskWorkersMutex);
+		const auto count = m_TaskWorkers.size();
+		if (!m_AutoScale.load() || count <= m_MinWorkers.load() || workerID + 1 != count || m_WorkerTokens[workerID] != token)
+			return false;
+
+		RemoveLastWorker();
+		return true;
+	}
+
+	INLINE void MPMCTaskScheduler::JoinRetiredWorkers() noexcept
+	{
+		Vector<PThread> retired;
+		{
+			LOCK(m_TaskWorkersMutex);
+			retired.swap(m_RetiredWorkers);
+		}
+		for (auto& worker : retired)
+			worker->Join();
+	}
+
+	INLINE void MPMCTaskScheduler::WakeAllWorkers() noexcept
+	{
+		// Workers check their state under these locks, so either they are waiting or they will see the change
+		{ LOCK(m_TaskQueueMutex); }
+		m_TaskQueueSignal.notify_all();
+		{ LOCK(m_IdleMutex); }
+		m_IdleSignal.notify_all();
+	}
+
+	inline void MPMCTaskScheduler::ConsiderScaleUp(Duration_t queueLatency, Timepoint_t now) noexcept
+	{
+		const auto threshold = m_ScaleUpLatency.load(std::memory_order_relaxed);
+		if (queueLatency.count() <= threshold)
+			return;
+
+		// An idle worker would have taken the work if it was there
+		const auto idle = m_Mode == TaskSchedulerMode_t::SharedQueue ? m_IdleWorkers.load(std::memory_order_relaxed) : m_SleepingWorkers.load(std::memory_order_relaxed);
+		if (idle > 0)
+			return;
+
+		// At most one worker each threshold, so a single burst doesn't spawn all of them
+		const auto nowTicks = now.time_since_epoch().count();
+		auto lastScaleUp = m_LastScaleUp.load(std::memory_order_relaxed);
+		if (nowTicks - lastScaleUp < threshold || !m_LastScaleUp.compare_exchange_strong(lastScaleUp, nowTicks, std::memory_order_relaxed))
+			return;
+
+		LOCK(m_TaskWorkersMutex);
+		const auto count = m_TaskWorkers.size();
+		if (!m_AutoScale.load() || count >= m_MaxWorkers.load() || m_PendingTasks.load() <= count)
+			return;
+
+		// We can't wait here, just release the ones that have already left
+		for (sizet i = 0; i < m_RetiredWorkers.size();)
+		{
+			if (m_RetiredWorkers[i]->TryJoin())
+			{
+				m_RetiredWorkers[i] = std::move(m_RetiredWorkers.back());
+				m_RetiredWorkers.pop_back();
+			}
+			else
+			{
+				++i;
+			}
+		}
+
+		UNUSED const auto res = AddWorkers(count + 1);
+	}
+
+	INLINE Duration_t MPMCTaskScheduler::GetIdleTimeout() const noexcept
+	{
+		return Duration_t(m_IdleTimeout.load(std::memory_order_relaxed));
+	}
+
+	inline void MPMCTaskScheduler::OnScalingPropertyChanged() noexcept
+	{
+		auto autoScale = ((WProperty<bool>)m_ScalingProps[AutoScaleProp]).lock();
+		auto minWorkers = ((WProperty<uint32>)m_ScalingProps[MinWorkersProp]).lock();
+		auto maxWorkers = ((WProperty<uint32>)m_ScalingProps[MaxWorkersProp]).lock();
+		auto latency = ((WProperty<uint32>)m_ScalingProps[ScaleUpLatencyProp]).lock();
+		auto idleTimeout = ((WProperty<uint32>)m_ScalingProps[IdleTimeoutProp]).lock();
+		if (autoScale == nullptr || minWorkers == nullptr || maxWorkers == nullptr || latency == nullptr || idleTimeout == nullptr)
+			return;
+
+		TaskSchedulerScaling scaling;
+		scaling.Enabled = autoScale->GetValueCopy();
+		scaling.MinWorkers = minWorkers->GetValueCopy();
+		scaling.MaxWorkers = maxWorkers->GetValueCopy();
+		scaling.ScaleUpLatency = std::chrono::microseconds(latency->GetValueCopy());
+		scaling.IdleTimeout = std::chrono::milliseconds(idleTimeout->GetValueCopy());
+		// An invalid combination keeps the previous policy
+		UNUSED const auto res = SetScaling(scaling);
+	}
+
+	template<class T>
+	INLINE TResult<WProperty<T>> MPMCTaskScheduler::GetOrCreateProperty(const PGreaperLib& library, const String& name, T initialValue, StringView info) noexcept
+	{
+		auto getRes = library->GetProperty(name);
+		if (getRes.IsOk())
+			return Result::CreateSuccess((WProperty<T>)getRes.GetValue());
+
+		auto createRes = CreateProperty<T>((WGreaperLib)library, name, std::move(initialValue), info, false, false, {});
+		if (createRes.HasFailed())
+			return Result::CopyFailure<WProperty<T>>(createRes);
+		return Result::CreateSuccess((WProperty<T>)createRes.GetValue());
+	}
+
+	INLINE void MPMCTaskScheduler::WorkerFn(MPMCTaskScheduler& scheduler, sizet id, uint64 token) noexcept
 	{
 		while (true)
 		{
-			SPtr<Impl::Task> task {};
+			Impl::Task* task = nullptr;
+			Timepoint_t now;
+			bool idleTimeout = false;
 			// Retrieve a task to do or check if we need to keep running
 			{
 				auto taskLck = UniqueLock<decltype(m_TaskQueueMutex)>(scheduler.m_TaskQueueMutex);
-				bool canWork = scheduler.CanWorkerContinueWorking(id);
+				bool canWork = scheduler.CanWorkerContinueWorking(id, token);
 				
-				// Wait for work or an stop request
-				while (scheduler.m_TaskQueue.empty() && canWork)
+				// Wait for work, an stop request or until we have been idle for too long
+				while (scheduler.m_TaskQueue.IsEmpty() && canWork && !idleTimeout)
 				{
-					scheduler.m_TaskQueueSignal.wait(taskLck);
-					canWork = scheduler.CanWorkerContinueWorking(id);
+					scheduler.m_IdleWorkers.fetch_add(1);
+					if (scheduler.m_AutoScale.load(std::memory_order_relaxed))
+						idleTimeout = !scheduler.m_TaskQueueSignal.wait_for(taskLck, scheduler.GetIdleTimeout());
+					else
+						scheduler.m_TaskQueueSignal.wait(taskLck);
+					scheduler.m_IdleWorkers.fetch_sub(1);
+					canWork = scheduler.CanWorkerContinueWorking(id, token);
 				}
 
 				// Stop working
@@ -349,27 +1055,511 @@ namespace greaper
 					break;
 
 				// Retrieve one task
-				if (!scheduler.m_TaskQueue.empty())
-				{
-					task = scheduler.m_TaskQueue.front();
-					scheduler.m_TaskQueue.pop_front();
-				}
+				now = Clock_t::now();
+				task = scheduler.m_TaskQueue.Pop(now);
 			}
 
 			// Do actual task work, and store the task memory on the free pool
 			if (task != nullptr)
+				scheduler.ExecuteTask(task, now);
+			else if (idleTimeout && scheduler.TryRetireWorker(id, token))
+				break;
+		}
+	}
+
+	INLINE void MPMCTaskScheduler::StealingWorkerFn(MPMCTaskScheduler& scheduler, sizet id, uint64 token) noexcept
+	{
+		auto* localQueue = scheduler.m_WorkQueues[id].load(std::memory_order_acquire);
+		if (localQueue == nullptr)
+		{
+			// First touched by this pinned thread, so its memory comes from the local NUMA node
+			localQueue = Construct<Impl::TaskWorkQueue>();
+			localQueue->Tasks.Reserve();
+			localQueue->Owner.store(token, std::memory_order_release);
+			scheduler.m_WorkQueues[id].store(localQueue, std::memory_order_release);
+		}
+		tl_WorkerScheduler = &scheduler;
+		tl_WorkerQueue = localQueue;
+		tl_WorkerToken = token;
+
+		while (localQueue->Owner.load(std::memory_order_acquire) == token)
+		{
+			const auto now = Clock_t::now();
+			// Newest local work first, keeps the caches warm
+			Impl::Task* task = scheduler.PopLocalTask(*localQueue, now);
+
+			// Oldest work from the other workers
+			if (task == nullptr)
+				task = scheduler.StealTask(id, now);
+
+			if (task != nullptr)
+			{
+				scheduler.ExecuteTask(task, now);
+				continue;
+			}
+
+			if (scheduler.ParkWorker(*localQueue, token) || !scheduler.TryRetireWorker(id, token))
+				continue;
+
+			// Someone may have pushed into our queue while we were leaving, and woken us for it
+			if (scheduler.m_QueuedTasks.load() > 0)
+				scheduler.WakeWorkers(1);
+			break;
+		}
+
+		tl_WorkerScheduler = nullptr;
+		tl_WorkerQueue = nullptr;
+		tl_WorkerToken = 0;
+	}
+
+	inline void MPMCTaskScheduler::TimerFn(MPMCTaskScheduler& scheduler) noexcept
+	{
+		auto lck = UniqueLock<decltype(m_TimerMutex)>(scheduler.m_TimerMutex);
+		auto& wheel = scheduler.m_TimerWheel;
+		Vector<TimerWheelNode*> expired;
+		Vector<Impl::Task*> dueTasks;
+		Vector<Impl::Timer*> dueTimers;
+		while (!scheduler.m_TimerStopped)
+		{
+			const auto now = Clock_t::now();
+			expired.clear();
+			wheel.Advance(scheduler.GetTimerTick(now, false), expired);
+			if (!expired.empty())
 			{
-				// Execute the task
-				task->m_State = TaskState_t::InProgress;
-				task->m_WorkFn();
-				task->m_State = TaskState_t::Completed;
-				// Store the task on to the free task pool
+				dueTasks.clear();
+				dueTimers.clear();
+				for (auto* node : expired)
 				{
-					auto freeLck = Lock(scheduler.m_FreeTaskPoolMutex);
-					scheduler.m_FreeTaskPool.push_back(task.get());
+					auto* timer = static_cast<Impl::Timer*>(node);
+					if (timer->TaskPtr != nullptr)
+					{
+						dueTasks.push_back(timer->TaskPtr);
+						TaskFunction callback;
+						scheduler.ReleaseTimer(timer, callback);
+					}
+					else
+					{
+						timer->Running = true;
+						dueTimers.push_back(timer);
+					}
 				}
-				task.reset();
+				lck.unlock();
+				scheduler.PostTimers(dueTasks, dueTimers);
+				lck.lock();
+				continue;
 			}
+
+			const auto nextTick = wheel.GetNextEventTick();
+			scheduler.m_TimerWakeTick = nextTick;
+			if (nextTick == std::numeric_limits<uint64>::max())
+			{
+				scheduler.m_TimerSignal.wait(lck);
+			}
+			else
+			{
+				// Rounded up, otherwise we would spin during the last millisecond
+				const auto wakeTime = scheduler.m_TimerEpoch + nextTick * TimerResolution;
+				scheduler.m_TimerSignal.wait_for(lck, std::chrono::ceil<std::chrono::milliseconds>(wakeTime - now));
+			}
+			scheduler.m_TimerWakeTick = 0;
+		}
+	}
+
+	INLINE Impl::Task* MPMCTaskScheduler::AcquireTask() noexcept
+	{
+		auto fpLck = Lock(m_FreeTaskPoolMutex);
+		if (m_FreeTaskPool.empty())
+			return Construct<Impl::Task>();
+
+		Impl::Task* taskPtr = m_FreeTaskPool.back();
+		m_FreeTaskPool.pop_back();
+		return taskPtr;
+	}
+
+	inline void MPMCTaskScheduler::AcquireTasks(sizet count, Vector<Impl::Task*>& tasks) noexcept
+	{
+		tasks.reserve(tasks.size() + count);
+		{
+			auto fpLck = Lock(m_FreeTaskPoolMutex);
+			const auto reused = Min(count, m_FreeTaskPool.size());
+			tasks.insert(tasks.end(), m_FreeTaskPool.end() - reused, m_FreeTaskPool.end());
+			m_FreeTaskPool.resize(m_FreeTaskPool.size() - reused);
+			count -= reused;
+		}
+		// The missing ones are constructed without holding the lock
+		for (; count > 0; --count)
+			tasks.push_back(Construct<Impl::Task>());
+	}
+
+	INLINE void MPMCTaskScheduler::PushTask(Impl::Task* task) noexcept
+	{
+		m_PendingTasks.fetch_add(1);
+		task->m_EnqueueTime = Clock_t::now();
+
+		if (m_Mode == TaskSchedulerMode_t::SharedQueue)
+		{
+			m_TaskQueueMutex.lock();
+			m_TaskQueue.Push(task);
+			const auto idle = m_IdleWorkers.load();
+			m_TaskQueueMutex.unlock();
+			if (idle > 0)
+				m_TaskQueueSignal.notify_one();
+			return;
+		}
+
+		// Workers of this scheduler push into their own queue, other threads distribute them
+		// in a round-robin fashion between the active workers
+		Impl::TaskWorkQueue* queue;
+		if (tl_WorkerScheduler == this && tl_WorkerQueue != nullptr && tl_WorkerQueue->Owner.load(std::memory_order_relaxed) == tl_WorkerToken)
+			queue = tl_WorkerQueue;
+		else
+			queue = m_WorkQueues[m_NextWorkQueue.fetch_add(1, std::memory_order_relaxed) % m_TaskWorkers.size()].load(std::memory_order_acquire);
+
+		// Count it before it is visible, so a parking worker never misses it
+		m_QueuedTasks.fetch_add(1);
+		queue->Lock.lock();
+		queue->Tasks.Push(task);
+		queue->Lock.unlock();
+
+		WakeWorkers(1);
+	}
+
+	inline void MPMCTaskScheduler::PushTasks(const Vector<Impl::Task*>& tasks) noexcept
+	{
+		const auto count = tasks.size();
+		m_PendingTasks.fetch_add(count);
+		const auto now = Clock_t::now();
+		for (auto* task : tasks)
+			task->m_EnqueueTime = now;
+
+		if (m_Mode == TaskSchedulerMode_t::SharedQueue)
+		{
+			m_TaskQueueMutex.lock();
+			for (auto* task : tasks)
+				m_TaskQueue.Push(task);
+			const auto idle = m_IdleWorkers.load();
+			m_TaskQueueMutex.unlock();
+			NotifyWorkers(m_TaskQueueSignal, count, idle);
+			return;
+		}
+
+		// Split the batch in one contiguous chunk per worker, so each queue is locked once
+		const auto workerCount = m_TaskWorkers.size();
+		const auto chunkSize = (count + workerCount - 1) / workerCount;
+		const auto firstQueue = m_NextWorkQueue.fetch_add(workerCount, std::memory_order_relaxed);
+
+		// Count them before they are visible, so a parking worker never misses them
+		m_QueuedTasks.fetch_add(count);
+		for (sizet begin = 0, i = 0; begin < count; begin += chunkSize, ++i)
+		{
+			const auto end = Min(begin + chunkSize, count);
+			auto* queue = m_WorkQueues[(firstQueue + i) % workerCount].load(std::memory_order_acquire);
+			queue->Lock.lock();
+			for (sizet t = begin; t < end; ++t)
+				queue->Tasks.Push(tasks[t]);
+			queue->Lock.unlock();
+		}
+
+		WakeWorkers(count);
+	}
+
+	INLINE void MPMCTaskScheduler::ExecuteTask(Impl::Task* task, Timepoint_t dequeueTime) noexcept
+	{
+		// A cancelled task has already been completed by its canceller
+		auto expected = TaskState_t::Inactive;
+		if (!task->m_State.compare_exchange_strong(expected, TaskState_t::InProgress))
+		{
+			if (ReleaseCancelledTask(task))
+				RecycleTask(task);
+			return;
+		}
+
+		auto& counters = m_LaneCounters[task->m_Priority];
+		const auto queueLatency = dequeueTime - task->m_EnqueueTime;
+		counters.QueueLatency.Record(queueLatency);
+		if (dequeueTime > task->m_Deadline)
+			counters.DeadlineMisses.fetch_add(1, std::memory_order_relaxed);
+
+		if (m_AutoScale.load(std::memory_order_relaxed))
+			ConsiderScaleUp(queueLatency, dequeueTime);
+
+		// Execute the task, and release its captures
+		auto* prevScheduler = std::exchange(tl_CurrentScheduler, this);
+		auto* prevTask = std::exchange(tl_CurrentTask, task);
+		task->m_WorkFn();
+		tl_CurrentScheduler = prevScheduler;
+		tl_CurrentTask = prevTask;
+		task->m_WorkFn = nullptr;
+		// Wake its waiters before it can be reused
+		task->Complete(task->m_CancelRequested.load() ? TaskState_t::Cancelled : TaskState_t::Completed);
+		RecycleTask(task);
+	}
+
+	INLINE void MPMCTaskScheduler::RecycleTask(Impl::Task* task) noexcept
+	{
+		task->m_CancelRequested.store(false, std::memory_order_relaxed);
+		task->m_CancelReleases.store(0, std::memory_order_relaxed);
+		// Store the task on to the free task pool
+		{
+			auto freeLck = Lock(m_FreeTaskPoolMutex);
+			m_FreeTaskPool.push_back(task);
+		}
+		OnTaskFinished();
+	}
+
+	INLINE bool MPMCTaskScheduler::ReleaseCancelledTask(Impl::Task* task) noexcept
+	{
+		return task->m_CancelReleases.fetch_add(1) == 1;
+	}
+
+	INLINE void MPMCTaskScheduler::RunAndDestroyTask(Impl::Task* task) noexcept
+	{
+		auto expected = TaskState_t::Inactive;
+		if (task->m_State.compare_exchange_strong(expected, TaskState_t::InProgress))
+		{
+			task->m_WorkFn();
+			task->Complete(TaskState_t::Completed);
+		}
+		// A cancelled one is still referenced by its canceller until it has been released twice
+		else if (!ReleaseCancelledTask(task))
+		{
+			return;
+		}
+		Destroy(task);
+	}
+
+	INLINE void MPMCTaskScheduler::StopTimer() noexcept
+	{
+		PThread timer;
+		{
+			LOCK(m_TimerMutex);
+			m_TimerStopped = true;
+			timer = std::move(m_TimerThread);
+		}
+		if (timer == nullptr)
+			return;
+
+		m_TimerSignal.notify_all();
+		timer->Join();
+	}
+
+	INLINE EmptyResult MPMCTaskScheduler::StartTimerThread() noexcept
+	{
+		if (m_TimerThread != nullptr)
+			return Result::CreateSuccess();
+
+		if (m_ThreadManager.expired())
+			return Result::CreateFailure(Format("Couldn't start the timer of the MPMCTaskScheduler '%s', the ThreadManager has expired.", m_Name.c_str()));
+
+		ThreadConfig cfg;
+		auto threadName = Format("%s_Timer", m_Name.c_str());
+		cfg.Name = threadName;
+		cfg.ThreadFN = [this]() { TimerFn(*this); };
+		auto thRes = m_ThreadManager.lock()->CreateThread(cfg);
+		if (thRes.HasFailed())
+			return Result::CopyFailure(thRes);
+		m_TimerThread = thRes.GetValue();
+		return Result::CreateSuccess();
+	}
+
+	INLINE Impl::Timer* MPMCTaskScheduler::AcquireTimer() noexcept
+	{
+		if (m_FreeTimers.empty())
+			return Construct<Impl::Timer>();
+
+		auto* timer = m_FreeTimers.back();
+		m_FreeTimers.pop_back();
+		return timer;
+	}
+
+	INLINE void MPMCTaskScheduler::ReleaseTimer(Impl::Timer* timer, TaskFunction& callback) noexcept
+	{
+		// Invalidates its handles
+		++timer->Generation;
+		callback = std::move(timer->Callback);
+		timer->Callback = nullptr;
+		timer->TaskPtr = nullptr;
+		timer->PeriodTicks = 0;
+		timer->SlackTicks = 0;
+		timer->Running = false;
+		timer->Cancelled = false;
+		m_FreeTimers.push_back(timer);
+	}
+
+	INLINE bool MPMCTaskScheduler::ArmTimer(Impl::Timer* timer, uint64 scheduledTick) noexcept
+	{
+		timer->ScheduledTick = scheduledTick;
+		// Rounded up to a multiple of the biggest power of two within the slack, so the timers
+		// with overlapping windows end up on the same tick
+		uint64 dueTick = scheduledTick;
+		if (timer->SlackTicks > 1)
+		{
+			const uint64 granularity = 1ull << FloorLog2(timer->SlackTicks);
+			dueTick = (dueTick + granularity - 1) & ~(granularity - 1);
+		}
+		m_TimerWheel.Insert(timer, dueTick);
+		return timer->DueTick < m_TimerWakeTick;
+	}
+
+	INLINE uint64 MPMCTaskScheduler::GetTimerTick(Timepoint_t time, bool roundUp) const noexcept
+	{
+		if (time <= m_TimerEpoch)
+			return 0;
+
+		const auto elapsed = time - m_TimerEpoch;
+		const auto ticks = roundUp ? std::chrono::ceil<std::chrono::milliseconds>(elapsed) : std::chrono::floor<std::chrono::milliseconds>(elapsed);
+		return (uint64)ticks.count() / TimerResolution.count();
+	}
+
+	inline void MPMCTaskScheduler::PostTimers(Vector<Impl::Task*>& dueTasks, const Vector<Impl::Timer*>& dueTimers) noexcept
+	{
+		const auto firstTimerTask = dueTasks.size();
+		AcquireTasks(dueTimers.size(), dueTasks);
+		for (sizet i = 0; i < dueTimers.size(); ++i)
+		{
+			auto* timer = dueTimers[i];
+			auto* taskPtr = dueTasks[firstTimerTask + i];
+			taskPtr->m_Name.assign(timer->Name);
+			taskPtr->m_State = TaskState_t::Inactive;
+			taskPtr->m_WorkFn = [this, timer]() { RunTimer(timer); };
+			taskPtr->m_Priority = timer->Priority;
+			taskPtr->m_Deadline = Timepoint_t::max();
+		}
+		SubmitDueTasks(dueTasks);
+	}
+
+	inline void MPMCTaskScheduler::RunTimer(Impl::Timer* timer) noexcept
+	{
+		// Nobody else touches the callback while running
+		timer->Callback();
+
+		TaskFunction callback;
+		bool wakeTimer = false;
+		{
+			LOCK(m_TimerMutex);
+			timer->Running = false;
+			if (timer->Cancelled || timer->PeriodTicks == 0 || m_TimerStopped)
+			{
+				ReleaseTimer(timer, callback);
+			}
+			else
+			{
+				// Fixed rate, but the periods we are late for are skipped
+				const auto period = timer->PeriodTicks;
+				const auto nowTick = GetTimerTick(Clock_t::now(), false);
+				uint64 nextTick = timer->ScheduledTick + period;
+				if (nextTick <= nowTick)
+					nextTick += ((nowTick - nextTick) / period + 1) * period;
+				wakeTimer = ArmTimer(timer, nextTick);
+			}
+		}
+		if (wakeTimer)
+			m_TimerSignal.notify_one();
+	}
+
+	INLINE void MPMCTaskScheduler::SubmitDueTasks(const Vector<Impl::Task*>& tasks) noexcept
+	{
+		if (tasks.empty())
+			return;
+
+		{
+			auto wkLck = SharedLock(m_TaskWorkersMutex);
+			if (AreThereAnyAvailableWorker())
+			{
+				PushTasks(tasks);
+				return;
+			}
+		}
+		// No one can run them, do it here so the tasks always finish
+		for (auto* task : tasks)
+		{
+			m_PendingTasks.fetch_add(1);
+			const auto now = Clock_t::now();
+			task->m_EnqueueTime = now;
+			ExecuteTask(task, now);
+		}
+	}
+
+	INLINE void MPMCTaskScheduler::OnTaskFinished() noexcept
+	{
+		if (m_PendingTasks.fetch_sub(1) != 1 || m_FinishWaiters.load() == 0)
+			return;
+
+		{ LOCK(m_FinishedMutex); }
+		m_FinishedSignal.notify_all();
+	}
+
+	INLINE Impl::Task* MPMCTaskScheduler::PopLocalTask(Impl::TaskWorkQueue& queue, Timepoint_t now) noexcept
+	{
+		queue.Lock.lock();
+		Impl::Task* task = queue.Tasks.Pop(now, true);
+		queue.Lock.unlock();
+		if (task != nullptr)
+			m_QueuedTasks.fetch_sub(1);
+		return task;
+	}
+
+	INLINE Impl::Task* MPMCTaskScheduler::StealTask(sizet thiefID, Timepoint_t now) noexcept
+	{
+		const auto queueCount = m_WorkQueueCount.load(std::memory_order_acquire);
+		for (sizet i = 1; i < queueCount; ++i)
+		{
+			auto* victim = m_WorkQueues[(thiefID + i) % queueCount].load(std::memory_order_acquire);
+			if (victim == nullptr)
+				continue;
+
+			// Avoid waiting on a busy victim, just try the next one
+			if (!victim->Lock.try_lock())
+				continue;
+
+			Impl::Task* task = victim->Tasks.Pop(now);
+			victim->Lock.unlock();
+
+			if (task != nullptr)
+			{
+				m_QueuedTasks.fetch_sub(1);
+				return task;
+			}
+		}
+		return nullptr;
+	}
+
+	INLINE bool MPMCTaskScheduler::ParkWorker(Impl::TaskWorkQueue& queue, uint64 token) noexcept
+	{
+		auto lck = UniqueLock<decltype(m_IdleMutex)>(m_IdleMutex);
+		m_SleepingWorkers.fetch_add(1);
+		bool signaled = true;
+		// Queued tasks may be on a busy victim we skipped, in that case we return and retry
+		while (signaled && m_QueuedTasks.load() == 0 && queue.Owner.load(std::memory_order_acquire) == token)
+		{
+			if (m_AutoScale.load(std::memory_order_relaxed))
+				signaled = m_IdleSignal.wait_for(lck, GetIdleTimeout());
+			else
+				m_IdleSignal.wait(lck);
+		}
+		m_SleepingWorkers.fetch_sub(1);
+		return signaled || m_QueuedTasks.load() > 0;
+	}
+
+	INLINE void MPMCTaskScheduler::WakeWorkers(sizet count) noexcept
+	{
+		const auto sleeping = m_SleepingWorkers.load();
+		if (sleeping == 0)
+			return;
+
+		{ LOCK(m_IdleMutex); }
+		NotifyWorkers(m_IdleSignal, count, sleeping);
+	}
+
+	INLINE void MPMCTaskScheduler::NotifyWorkers(Signal& signal, sizet count, sizet idle) noexcept
+	{
+		if (count >= idle)
+		{
+			if (idle > 0)
+				signal.notify_all();
+			return;
 		}
+		for (sizet i = 0; i < count; ++i)
+			signal.notify_one();
 	}
 }
\ No newline at end of file
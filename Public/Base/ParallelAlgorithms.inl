@@ -0,0 +1,188 @@
+/***********************************************************************************
+*   Copyright 2022 Marcos Sánchez Torrent.                                         *
+*   All Rights Reserved.                                                           *
+***********************************************************************************/
+
+#pragma once
+
+//#include "../ParallelAlgorithms.h"
+
+namespace greaper
+{
+	namespace Impl
+	{
+		INLINE bool ParallelRange::ClaimChunk(sizet& chunkBegin, sizet& chunkEnd) noexcept
+		{
+			const auto chunk = NextChunk.fetch_add(1, std::memory_order_relaxed);
+			if (chunk >= ChunkCount)
+				return false;
+
+			chunkBegin = Begin + chunk * Grain;
+			chunkEnd = Min(chunkBegin + Grain, End);
+			return true;
+		}
+
+		INLINE void ParallelRange::FinishChunks(uint32 count) noexcept
+		{
+			if (count == 0)
+				return;
+
+			if (FinishedChunks.fetch_add(count) + count == ChunkCount && Waiters.load() > 0)
+				AtomicNotifyAll(FinishedChunks);
+		}
+
+		INLINE void ParallelRange::WaitUntilFinished() noexcept
+		{
+			// Only claimed chunks can be pending here, and those are already running
+			while (true)
+			{
+				const uint32 finished = FinishedChunks.load();
+				if (finished == ChunkCount)
+					break;
+				Waiters.fetch_add(1);
+				AtomicWait(FinishedChunks, finished);
+				Waiters.fetch_sub(1);
+			}
+		}
+
+		template<class WorkFn>
+		INLINE ParallelJob<WorkFn>::ParallelJob(const WorkFn& work) noexcept
+			:Work(work)
+		{
+
+		}
+
+		template<class WorkFn>
+		INLINE void ParallelJob<WorkFn>::Release() noexcept
+		{
+			if (References.fetch_sub(1) == 1)
+				Destroy(this);
+		}
+
+		INLINE bool SubmitParallelTask(const PTaskScheduler& scheduler, TaskFunction workFn) noexcept
+		{
+			return scheduler->AddTask("ParallelTask"sv, std::move(workFn)).IsOk();
+		}
+
+		INLINE bool SubmitParallelTask(const PSlimScheduler& scheduler, TaskFunction workFn) noexcept
+		{
+			return scheduler->AddTask(std::move(workFn)).IsOk();
+		}
+
+		template<class Scheduler, class Participant>
+		inline void ParallelRun(const SPtr<Scheduler>& scheduler, sizet begin, sizet end, sizet grain, Participant&& participant) noexcept
+		{
+			if (end <= begin)
+				return;
+
+			const sizet count = end - begin;
+			const sizet workerCount = scheduler != nullptr ? scheduler->GetWorkerCount() : 0;
+			if (grain == 0)
+				grain = Max(count / ((workerCount + 1) * ParallelRange::ChunksPerParticipant), (sizet)1);
+			// Chunk count must fit in 32bits to be able to wait on it
+			grain = Max(grain, (count - 1) / (sizet)0xFFFFFFFF + 1);
+			const auto chunkCount = (uint32)((count - 1) / grain + 1);
+			const auto helperCount = Min(workerCount, (sizet)chunkCount - 1);
+
+			// Nothing to share, avoid the allocation
+			if (helperCount == 0)
+			{
+				ParallelRange range;
+				range.Begin = begin;
+				range.End = end;
+				range.Grain = grain;
+				range.ChunkCount = chunkCount;
+				participant(range);
+				return;
+			}
+
+			using Job_t = ParallelJob<std::decay_t<Participant>>;
+			auto* job = Construct<Job_t>(participant);
+			job->Begin = begin;
+			job->End = end;
+			job->Grain = grain;
+			job->ChunkCount = chunkCount;
+
+			for (sizet i = 0; i < helperCount; ++i)
+			{
+				job->References.fetch_add(1);
+				if (!SubmitParallelTask(scheduler, [job]() { job->Work(*job); job->Release(); }))
+				{
+					job->References.fetch_sub(1);
+					break;
+				}
+			}
+
+			job->Work(*job);
+			job->WaitUntilFinished();
+			job->Release();
+		}
+	}
+
+	template<class Scheduler, class F>
+	inline void ParallelFor(const SPtr<Scheduler>& scheduler, sizet begin, sizet end, sizet grain, F&& fn) noexcept
+	{
+		// Late helpers won't claim any chunk, so fn is never touched once we return
+		Impl::ParallelRun(scheduler, begin, end, grain, [&fn](Impl::ParallelRange& range)
+			{
+				sizet chunkBegin, chunkEnd;
+				uint32 done = 0;
+				while (range.ClaimChunk(chunkBegin, chunkEnd))
+				{
+					for (sizet i = chunkBegin; i < chunkEnd; ++i)
+						fn(i);
+					++done;
+				}
+				range.FinishChunks(done);
+			});
+	}
+
+	template<class Scheduler, class T, class F>
+	INLINE void ParallelFor(const SPtr<Scheduler>& scheduler, const Span<T>& range, sizet grain, F&& fn) noexcept
+	{
+		ParallelFor(scheduler, 0, range.GetSizeFn(), grain, [&range, &fn](sizet idx) { fn(range.GetElementFn(idx)); });
+	}
+
+	template<class Scheduler, class T, class F>
+	INLINE void ParallelFor(const SPtr<Scheduler>& scheduler, const CSpan<T>& range, sizet grain, F&& fn) noexcept
+	{
+		ParallelFor(scheduler, 0, range.GetSizeFn(), grain, [&range, &fn](sizet idx) { fn(range.GetElementFn(idx)); });
+	}
+
+	template<class Scheduler, class T, class R, class MapFn, class CombineFn>
+	inline R ParallelReduce(const SPtr<Scheduler>& scheduler, const CSpan<T>& range, R identity, MapFn&& map, CombineFn&& combine, sizet grain) noexcept
+	{
+		R result = identity;
+		SpinLock resultLock;
+		Impl::ParallelRun(scheduler, 0, range.GetSizeFn(), grain, [&](Impl::ParallelRange& pr)
+			{
+				// Claim before touching anything, late helpers must not access our stack
+				sizet chunkBegin, chunkEnd;
+				if (!pr.ClaimChunk(chunkBegin, chunkEnd))
+					return;
+
+				R partial = identity;
+				uint32 done = 0;
+				do
+				{
+					for (sizet i = chunkBegin; i < chunkEnd; ++i)
+						partial = combine(std::move(partial), map(range.GetElementFn(i)));
+					++done;
+				} while (pr.ClaimChunk(chunkBegin, chunkEnd));
+
+				{
+					LOCK(resultLock);
+					result = combine(std::move(result), std::move(partial));
+				}
+				pr.FinishChunks(done);
+			});
+		return result;
+	}
+
+	template<class Scheduler, class T, class R, class MapFn, class CombineFn>
+	INLINE R ParallelReduce(const SPtr<Scheduler>& scheduler, const Span<T>& range, R identity, MapFn&& map, CombineFn&& combine, sizet grain) noexcept
+	{
+		const auto constRange = CSpan<T>(range.GetSizeFn, [&range](std::size_t idx) -> const T& { return range.GetElementFn(idx); });
+		return ParallelReduce(scheduler, constRange, std::move(identity), std::forward<MapFn>(map), std::forward<CombineFn>(combine), grain);
+	}
+}
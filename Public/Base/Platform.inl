@@ -23,6 +23,8 @@ INLINE void greaper::OSPlatform::PerLibraryInit()
 	_PerLibraryInit();
 
 	InitCPUInfo();
+	InitCPUTopology();
+	SIMDDispatch::Initialize(m_CPUInfo);
 }
 
 INLINE const greaper::CPUInfo& greaper::OSPlatform::GetCPUInfo() noexcept
@@ -30,6 +32,11 @@ INLINE const greaper::CPUInfo& greaper::OSPlatform::GetCPUInfo() noexcept
 	return m_CPUInfo;
 }
 
+INLINE const greaper::CPUTopology& greaper::OSPlatform::GetCPUTopology() noexcept
+{
+	return m_CPUTopology;
+}
+
 INLINE void greaper::OSPlatform::InitCPUInfo() noexcept
 {
 	std::array<int32, 4> info{};
@@ -110,9 +117,88 @@ INLINE void greaper::OSPlatform::InitCPUInfo() noexcept
 		m_CPUInfo.Features.FMA4 = (info[2] & ((int)1 << 16)) != 0;
 	}
 
-	if (osHasXSAVE_XRESTORE && m_CPUInfo.Features.AVX != 0)
+	// The OS has to save the wider registers on context switches, XMM|YMM and opmask|ZMM_Hi256|Hi16_ZMM
+	const auto xcrFeatureMask = osHasXSAVE_XRESTORE ? _xgetbv(_XCR_XFEATURE_ENABLED_MASK) : 0;
+	if ((xcrFeatureMask & 0x6) != 0x6)
+	{
+		m_CPUInfo.Features.AVX = 0;
+		m_CPUInfo.Features.AVX2 = 0;
+		m_CPUInfo.Features.FMA3 = 0;
+	}
+	if ((xcrFeatureMask & 0xE6) != 0xE6)
+	{
+		m_CPUInfo.Features.AVX512F = 0;
+		m_CPUInfo.Features.AVX512CD = 0;
+		m_CPUInfo.Features.AVX512ER = 0;
+		m_CPUInfo.Features.AVX512PF = 0;
+		m_CPUInfo.Features.AVX512BW = 0;
+		m_CPUInfo.Features.AVX512DQ = 0;
+		m_CPUInfo.Features.AVX512VL = 0;
+		m_CPUInfo.Features.AVX512IFMA = 0;
+		m_CPUInfo.Features.AVX512VBMI = 0;
+		m_CPUInfo.Features.AVX512VBMI2 = 0;
+		m_CPUInfo.Features.AVX512VNNI = 0;
+		m_CPUInfo.Features.AVX512BITALG = 0;
+		m_CPUInfo.Features.AVX512VPOPCNTDQ = 0;
+		m_CPUInfo.Features.AVX512FP16 = 0;
+	}
+}
+
+INLINE void greaper::OSPlatform::InitCPUTopology() noexcept
+{
+	m_CPUTopology = {};
+	m_CPUTopology.LogicalCoreCount = Max(std::thread::hardware_concurrency(), 1u);
+
+	// Deterministic cache parameters, Intel leaf 4 and AMD 0x8000001D share the layout
+	std::array<int32, 4> info{};
+	uint32 cacheLeaf = 0;
+	cpuid(info.data(), 0);
+	const auto nIDs = (uint32)info[0];
+	cpuid(info.data(), 0x80000000);
+	const auto nExIDs = (uint32)info[0];
+	if (m_CPUInfo.Vendor == CPUVendor_t::INTEL && nIDs >= 0x00000004)
+	{
+		cacheLeaf = 0x00000004;
+	}
+	else if (m_CPUInfo.Vendor == CPUVendor_t::AMD && nExIDs >= 0x8000001D)
+	{
+		cpuid(info.data(), 0x80000001);
+		// Topology extensions
+		if ((info[2] & ((int)1 << 22)) != 0)
+			cacheLeaf = 0x8000001D;
+	}
+	for (uint32 subLeaf = 0; cacheLeaf != 0 && subLeaf < 16; ++subLeaf)
+	{
+		cpuidex(info.data(), cacheLeaf, subLeaf);
+		const auto type = (uint32)info[0] & 0x1F;
+		if (type == 0)
+			break;
+
+		CPUCacheInfo cache;
+		cache.Type = type == 1 ? CPUCacheType_t::DATA : (type == 2 ? CPUCacheType_t::INSTRUCTION : CPUCacheType_t::UNIFIED);
+		cache.Level = ((uint32)info[0] >> 5) & 0x7;
+		cache.LineSize = ((uint32)info[1] & 0xFFF) + 1;
+		const auto partitions = (((uint32)info[1] >> 12) & 0x3FF) + 1;
+		cache.Associativity = (((uint32)info[1] >> 22) & 0x3FF) + 1;
+		const auto sets = (uint32)info[2] + 1;
+		cache.Size = cache.Associativity * partitions * cache.LineSize * sets;
+		m_CPUTopology.AddCacheInstance(cache, {});
+	}
+
+	// The OS knows which CPUs share what, and replaces whatever it knows better
+	_InitCPUTopology(m_CPUTopology);
+
+	if (m_CPUTopology.SMTSiblings.empty())
 	{
-		auto xcrFeatureMask = _xgetbv(_XCR_XFEATURE_ENABLED_MASK);
-		m_CPUInfo.Features.AVX = (xcrFeatureMask & 0x6) == 0x6;
+		for (uint32 cpu = 0; cpu < m_CPUTopology.LogicalCoreCount; ++cpu)
+			m_CPUTopology.SMTSiblings.push_back({ cpu });
 	}
-}
\ No newline at end of file
+	if (m_CPUTopology.NUMANodes.empty())
+	{
+		m_CPUTopology.NUMANodes.emplace_back();
+		for (uint32 cpu = 0; cpu < m_CPUTopology.LogicalCoreCount; ++cpu)
+			m_CPUTopology.NUMANodes[0].push_back(cpu);
+	}
+	m_CPUTopology.PhysicalCoreCount = (uint32)m_CPUTopology.SMTSiblings.size();
+	m_CPUTopology.PackageCount = Max(m_CPUTopology.PackageCount, 1u);
+}
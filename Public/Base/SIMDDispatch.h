@@ -0,0 +1,237 @@
+/***********************************************************************************
+*   Copyright 2022 Marcos Sánchez Torrent.                                         *
+*   All Rights Reserved.                                                           *
+***********************************************************************************/
+
+#pragma once
+
+#ifndef CORE_SIMD_DISPATCH_H
+#define CORE_SIMD_DISPATCH_H 1
+
+#include "../Enumeration.h"
+#include "CPUInfo.h"
+
+ENUMERATION(SIMDLevel, Scalar, SSE42, AVX2, AVX512);
+
+/* Compiles a function for the given instruction set, even if the rest of the code isn't */
+#if COMPILER_MSVC
+#define SIMD_TARGET(isa)
+#else
+#define SIMD_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace greaper
+{
+	class SIMDDispatch;
+
+	template<class Fn>
+	class SIMDKernel;
+
+	namespace Impl
+	{
+		class SIMDKernelBase
+		{
+		public:
+			SIMDKernelBase(const SIMDKernelBase&) = delete;
+			SIMDKernelBase& operator=(const SIMDKernelBase&) = delete;
+
+		protected:
+			SIMDKernelBase()noexcept = default;
+			~SIMDKernelBase()noexcept = default;
+
+			virtual void Bind(SIMDLevel_t maxLevel)noexcept = 0;
+
+		private:
+			SIMDKernelBase* m_Prev = nullptr;
+			SIMDKernelBase* m_Next = nullptr;
+
+			friend class greaper::SIMDDispatch;
+		};
+	}
+
+	/*** Binds every SIMDKernel to the best implementation the CPU can run
+	*
+	*	Kernels register themselves on construction and are bound right away
+	*	to the current level, Scalar until OSPlatform::PerLibraryInit calls
+	*	Initialize. Calling a kernel is an indirect call through a pointer
+	*	chosen once, no feature checks are done per call. The level can be
+	*	forced down with SetLevelOverride, the Application exposes it through
+	*	its SIMDLevelOverride property so each implementation can be tested.
+	*/
+	class SIMDDispatch
+	{
+	public:
+		/*** Highest level whose instructions the CPU and the OS support */
+		NODISCARD static SIMDLevel_t GetSupportedLevel(const CPUInfo& info)noexcept;
+
+		/*** Binds all the kernels to the supported level, unless overridden */
+		static void Initialize(const CPUInfo& info)noexcept;
+
+		/*** Level the kernels are currently bound to, at most */
+		NODISCARD static SIMDLevel_t GetLevel()noexcept;
+
+		/*** Forces the kernels to use at most level, COUNT removes the override */
+		static EmptyResult SetLevelOverride(SIMDLevel_t level)noexcept;
+
+		static void Register(Impl::SIMDKernelBase* kernel)noexcept;
+
+		static void Unregister(Impl::SIMDKernelBase* kernel)noexcept;
+
+	private:
+		static inline Impl::SIMDKernelBase* m_Kernels = nullptr;
+		static inline SIMDLevel_t m_SupportedLevel = SIMDLevel_t::Scalar;
+		static inline SIMDLevel_t m_Override = SIMDLevel_t::COUNT;
+		static inline std::atomic<SIMDLevel_t> m_Level{ SIMDLevel_t::Scalar };
+
+		/*** Kernels register during the static initialization, so the mutex can't be a static member */
+		static Mutex& GetMutex()noexcept;
+
+		/*** Expects GetMutex() to be locked */
+		static void BindAll()noexcept;
+	};
+
+	/*** Function with several implementations, one per SIMDLevel
+	*	Only the Scalar implementation is required, the missing levels fall
+	*	back to the closest lower one. Meant to be a static or global object.
+	*/
+	template<class R, class... Args>
+	class SIMDKernel<R(Args...)> final : public Impl::SIMDKernelBase
+	{
+	public:
+		using FunctionPtr = R(*)(Args...);
+
+		SIMDKernel(FunctionPtr scalar, FunctionPtr sse42 = nullptr, FunctionPtr avx2 = nullptr, FunctionPtr avx512 = nullptr)noexcept;
+		~SIMDKernel()noexcept;
+
+		INLINE R operator()(Args... args)const noexcept { return m_Bound.load(std::memory_order_relaxed)(std::forward<Args>(args)...); }
+
+		NODISCARD SIMDLevel_t GetBoundLevel()const noexcept;
+
+		/*** Returns nullptr if there's no implementation for level */
+		NODISCARD FunctionPtr GetImplementation(SIMDLevel_t level)const noexcept;
+
+	private:
+		std::array<FunctionPtr, SIMDLevel_t::COUNT> m_Implementations;
+		std::atomic<FunctionPtr> m_Bound;
+		std::atomic<SIMDLevel_t> m_BoundLevel{ SIMDLevel_t::Scalar };
+
+		void Bind(SIMDLevel_t maxLevel)noexcept override;
+	};
+
+	INLINE SIMDLevel_t SIMDDispatch::GetSupportedLevel(const CPUInfo& info) noexcept
+	{
+		const auto& features = info.Features;
+		if (features.AVX512F && features.AVX512BW && features.AVX512DQ && features.AVX512VL && features.AVX2)
+			return SIMDLevel_t::AVX512;
+		if (features.AVX2 && features.AVX)
+			return SIMDLevel_t::AVX2;
+		if (features.SSE42)
+			return SIMDLevel_t::SSE42;
+		return SIMDLevel_t::Scalar;
+	}
+
+	INLINE void SIMDDispatch::Initialize(const CPUInfo& info) noexcept
+	{
+		auto lck = Lock(GetMutex());
+		m_SupportedLevel = GetSupportedLevel(info);
+		BindAll();
+	}
+
+	INLINE SIMDLevel_t SIMDDispatch::GetLevel() noexcept
+	{
+		return m_Level.load(std::memory_order_relaxed);
+	}
+
+	INLINE EmptyResult SIMDDispatch::SetLevelOverride(SIMDLevel_t level) noexcept
+	{
+		auto lck = Lock(GetMutex());
+		if (level != SIMDLevel_t::COUNT && level > m_SupportedLevel)
+		{
+			return Result::CreateFailure(Format("Trying to force the SIMD level '%s', but this CPU only supports up to '%s'.",
+				TEnum<SIMDLevel_t>::ToString(level).data(), TEnum<SIMDLevel_t>::ToString(m_SupportedLevel).data()));
+		}
+		m_Override = level;
+		BindAll();
+		return Result::CreateSuccess();
+	}
+
+	INLINE void SIMDDispatch::Register(Impl::SIMDKernelBase* kernel) noexcept
+	{
+		auto lck = Lock(GetMutex());
+		kernel->m_Prev = nullptr;
+		kernel->m_Next = m_Kernels;
+		if (m_Kernels != nullptr)
+			m_Kernels->m_Prev = kernel;
+		m_Kernels = kernel;
+		kernel->Bind(m_Level.load(std::memory_order_relaxed));
+	}
+
+	INLINE void SIMDDispatch::Unregister(Impl::SIMDKernelBase* kernel) noexcept
+	{
+		auto lck = Lock(GetMutex());
+		if (kernel->m_Prev != nullptr)
+			kernel->m_Prev->m_Next = kernel->m_Next;
+		else if (m_Kernels == kernel)
+			m_Kernels = kernel->m_Next;
+		if (kernel->m_Next != nullptr)
+			kernel->m_Next->m_Prev = kernel->m_Prev;
+		kernel->m_Prev = nullptr;
+		kernel->m_Next = nullptr;
+	}
+
+	INLINE Mutex& SIMDDispatch::GetMutex() noexcept
+	{
+		static Mutex mutex;
+		return mutex;
+	}
+
+	INLINE void SIMDDispatch::BindAll() noexcept
+	{
+		const auto level = m_Override != SIMDLevel_t::COUNT ? m_Override : m_SupportedLevel;
+		m_Level.store(level, std::memory_order_relaxed);
+		for (auto* kernel = m_Kernels; kernel != nullptr; kernel = kernel->m_Next)
+			kernel->Bind(level);
+	}
+
+	template<class R, class... Args>
+	INLINE SIMDKernel<R(Args...)>::SIMDKernel(FunctionPtr scalar, FunctionPtr sse42, FunctionPtr avx2, FunctionPtr avx512) noexcept
+		:m_Implementations{ scalar, sse42, avx2, avx512 }
+		,m_Bound(scalar)
+	{
+		VerifyNot(scalar == nullptr, "Trying to create a SIMDKernel without a scalar implementation.");
+		SIMDDispatch::Register(this);
+	}
+
+	template<class R, class... Args>
+	INLINE SIMDKernel<R(Args...)>::~SIMDKernel() noexcept
+	{
+		SIMDDispatch::Unregister(this);
+	}
+
+	template<class R, class... Args>
+	INLINE SIMDLevel_t SIMDKernel<R(Args...)>::GetBoundLevel() const noexcept
+	{
+		return m_BoundLevel.load(std::memory_order_relaxed);
+	}
+
+	template<class R, class... Args>
+	INLINE typename SIMDKernel<R(Args...)>::FunctionPtr SIMDKernel<R(Args...)>::GetImplementation(SIMDLevel_t level) const noexcept
+	{
+		return level < SIMDLevel_t::COUNT ? m_Implementations[level] : nullptr;
+	}
+
+	template<class R, class... Args>
+	INLINE void SIMDKernel<R(Args...)>::Bind(SIMDLevel_t maxLevel) noexcept
+	{
+		for (sizet level = maxLevel + 1; level-- > 0;)
+		{
+			if (m_Implementations[level] == nullptr)
+				continue;
+			m_Bound.store(m_Implementations[level], std::memory_order_relaxed);
+			m_BoundLevel.store((SIMDLevel_t)level, std::memory_order_relaxed);
+			return;
+		}
+	}
+}
+
+#endif /* CORE_SIMD_DISPATCH_H */
@@ -166,42 +166,36 @@ namespace greaper
 			}
 			INLINE void AddSharedReference() noexcept override
 			{
-				++m_SharedReferences;
+				// All the shared references together hold one weak reference, so the last
+				// shared and the last weak reference can be released from different threads
+				if (m_SharedReferences.fetch_add(1) == 0)
+					m_WeakReferences.fetch_add(1);
 			}
 			INLINE void DecSharedReference() noexcept override
 			{
-				if (m_SharedReferences <= 1)
+				if (m_SharedReferences.fetch_sub(1) == 1)
 				{
 					if (m_Value != nullptr)
 					{
 						m_Deleter(m_Value);
 						m_Value = nullptr;
 					}
-					--m_SharedReferences;
-					if (m_WeakReferences <= 0)
-					{
-						PlatformDealloc(this);
-					}
-				}
-				else
-				{
-					--m_SharedReferences;
+					DecWeakReference();
 				}
 			}
 			INLINE void AddWeakReference() noexcept override
 			{
-				++m_WeakReferences;
+				m_WeakReferences.fetch_add(1);
 			}
 			INLINE void DecWeakReference() noexcept override
 			{
-				--m_WeakReferences;
-				if (m_WeakReferences <= 0 && m_SharedReferences <= 0)
+				if (m_WeakReferences.fetch_sub(1) == 1)
 				{
 					PlatformDealloc(this);
 				}
 			}
 			NODISCARD INLINE uint32 SharedRefCount()const noexcept override { return m_SharedReferences; }
-			NODISCARD INLINE uint32 WeakRefCount()const noexcept override { return m_WeakReferences; }
+			NODISCARD INLINE uint32 WeakRefCount()const noexcept override { return m_WeakReferences - (m_SharedReferences > 0 ? 1 : 0); }
 			NODISCARD INLINE void* GetValue()const noexcept override { return m_Value; }
 			NODISCARD INLINE SPtrType GetType()const noexcept override { return SPtrType::MultiThread; }
 
@@ -225,42 +219,36 @@ namespace greaper
 			}
 			INLINE void AddSharedReference() noexcept override
 			{
-				++m_SharedReferences;
+				// All the shared references together hold one weak reference, so the last
+				// shared and the last weak reference can be released from different threads
+				if (m_SharedReferences.fetch_add(1) == 0)
+					m_WeakReferences.fetch_add(1);
 			}
 			INLINE void DecSharedReference() noexcept override
 			{
-				if (m_SharedReferences <= 1)
+				if (m_SharedReferences.fetch_sub(1) == 1)
 				{
 					if (m_Value != nullptr)
 					{
 						m_Value->~T();
 						m_Value = nullptr;
 					}
-					--m_SharedReferences;
-					if (m_WeakReferences <= 0)
-					{
-						Dealloc<Allocator_>(this);
-					}
-				}
-				else
-				{
-					--m_SharedReferences;
+					DecWeakReference();
 				}
 			}
 			INLINE void AddWeakReference() noexcept override
 			{
-				++m_WeakReferences;
+				m_WeakReferences.fetch_add(1);
 			}
 			INLINE void DecWeakReference() noexcept override
 			{
-				--m_WeakReferences;
-				if (m_WeakReferences <= 0 && m_SharedReferences <= 0)
+				if (m_WeakReferences.fetch_sub(1) == 1)
 				{
 					Dealloc<Allocator_>(this);
 				}
 			}
 			NODISCARD INLINE uint32 SharedRefCount()const noexcept override { return m_SharedReferences; }
-			NODISCARD INLINE uint32 WeakRefCount()const noexcept override { return m_WeakReferences; }
+			NODISCARD INLINE uint32 WeakRefCount()const noexcept override { return m_WeakReferences - (m_SharedReferences > 0 ? 1 : 0); }
 			NODISCARD INLINE void* GetValue()const noexcept override { return m_Value; }
 			NODISCARD INLINE SPtrType GetType()const noexcept override { return SPtrType::MultiThread; }
 
@@ -74,18 +74,19 @@ namespace greaper
 					}
 					else
 					{
-						m_TaskQueueSignal.notify_all();
+						WakeUp(m_WorkEpoch, m_SleepingWorkers, true);
 						THREAD_YIELD();
 					}
 				}
-				m_TaskQueueMutex.lock();
+				m_TaskWorkersMutex.lock();
 				m_TaskWorkers.erase(m_TaskWorkers.begin() + (sz - 1));
 			}
+			m_TaskWorkersMutex.unlock();
 		}
 		return Result::CreateSuccess();
 	}
 	
-	inline TResult<uint32> SlimTaskScheduler::AddTask(std::function<void()> task) noexcept
+	inline TResult<uint32> SlimTaskScheduler::AddTask(TaskFunction task) noexcept
 	{
 		if (task == nullptr)
 			return Result::CreateFailure<uint32>("Trying to create a nullptr task."sv);
@@ -96,76 +97,31 @@ namespace greaper
 			return Result::CreateFailure<uint32>("Couldn't add the task, no available workers."sv);
 		}
 
-		uint32 taskSlotIdx;
-		{
-			auto lck = UniqueLock<decltype(m_TaskQueueMutex)>(m_TaskQueueMutex);
-			while (!IsNextTaskAvailable())
-				m_TaskQueueSignal.wait(lck);
-
-			taskSlotIdx = m_LastTaskSlotUsed++;
-			if (m_LastTaskSlotUsed >= m_TaskSlots.size())
-				taskSlotIdx = m_LastTaskSlotUsed = 0;
-			auto& taskSlot = m_TaskSlots[taskSlotIdx];
-			taskSlot.Task = std::move(task);
-			taskSlot.State = SlimTask::READY;
-		}
-
-		/*m_TaskQueueMutex.lock();
-		uint32 taskSlotIdx = m_LastTaskSlotUsed++;
-		if (m_LastTaskSlotUsed >= m_TaskSlots.size())
-			m_LastTaskSlotUsed = 0;
+		const uint32 taskSlotIdx = AcquireFreeSlot();
 		auto& taskSlot = m_TaskSlots[taskSlotIdx];
 		taskSlot.Task = std::move(task);
 		taskSlot.State = SlimTask::READY;
-		m_TaskQueueMutex.unlock();*/
-		m_TaskQueueSignal.notify_one();
-
-		//SlimTask* taskPtr;
-		//{
-		//	auto fpLck = Lock(m_FreeTaskPoolMutex);
-		//	if (m_FreeTaskPool.empty())
-		//	{
-		//		taskPtr = AllocT<SlimTask>();
-		//	}
-		//	else
-		//	{
-		//		taskPtr = m_FreeTaskPool.back();
-		//		m_FreeTaskPool.pop_back();
-		//	}
-		//}
-		// All taskPtr will be uninitialized memory so we call the move constructor
-		//new(taskPtr)SlimTask(std::move(task));
-		//
-		//m_TaskQueueMutex.lock();
-		//m_TaskQueue.push_back(taskPtr);
-		//m_TaskQueueMutex.unlock();
-		//m_TaskQueueSignal.notify_one();
+		const uint32 taskGeneration = taskSlot.Generation.load();
+
+		m_PendingTasks.fetch_add(1);
+		PushSlot(m_ReadySlots, taskSlotIdx);
+		WakeUp(m_WorkEpoch, m_SleepingWorkers, false);
 		
-		return Result::CreateSuccess(taskSlotIdx);
+		return Result::CreateSuccess((taskGeneration << TaskIDSlotBits) | taskSlotIdx);
 	}
 
 	INLINE void SlimTaskScheduler::WaitUntilTaskFinished(uint32 taskID)const noexcept
 	{
-		if (taskID >= m_TaskSlots.size())
+		const uint32 slotIdx = taskID & TaskIDSlotMask;
+		if (slotIdx >= m_TaskSlots.size())
 			return; // Invalid ID
 
-		// Don't add more tasks nor change the amount of workers
-		auto wkLck = SharedLock(m_TaskWorkersMutex);
-
-		// Wait until no more tasks
-		//auto lck = UniqueLock<decltype(m_TaskQueueMutex)>(m_TaskQueueMutex);
-		auto checkTask = [this](uint32 taskID)
-		{
-			LOCK(m_TaskQueueMutex);
-			const auto& slot = m_TaskSlots[taskID];
-			return slot.State != SlimTask::DONE && slot.Task != nullptr;
-		};
-		while (checkTask(taskID))
-		{
-			//m_TaskQueueSignal.wait(lck);
-			m_TaskQueueSignal.notify_one();
-			THREAD_YIELD();
-		}
+		// Sleep until the slot generation changes, which happens once that task is done,
+		// the slot can be reused afterwards, but with another generation
+		auto& slot = const_cast<SlimTask&>(m_TaskSlots[slotIdx]);
+		slot.Waiters.fetch_add(1);
+		AtomicWait(slot.Generation, taskID >> TaskIDSlotBits);
+		slot.Waiters.fetch_sub(1);
 	}
 
 	INLINE void SlimTaskScheduler::WaitUntilAllTasksFinished()const noexcept
@@ -173,13 +129,15 @@ namespace greaper
 		// Don't add more tasks nor change the amount of workers
 		auto wkLck = SharedLock(m_TaskWorkersMutex);
 
-		// Wait until no more tasks
-		//auto lck = UniqueLock<decltype(m_TaskQueueMutex)>(m_TaskQueueMutex);
-		while (!IsTaskQueueEmpty())
+		// Sleep until the pending count reaches zero, the last task to finish wakes us up
+		while (true)
 		{
-			//m_TaskQueueSignal.wait(lck);
-			m_TaskQueueSignal.notify_one();
-			THREAD_YIELD();
+			const uint32 pending = m_PendingTasks.load();
+			if (pending == 0)
+				break;
+			m_FinishWaiters.fetch_add(1);
+			AtomicWait(m_PendingTasks, pending);
+			m_FinishWaiters.fetch_sub(1);
 		}
 	}
 
@@ -242,23 +200,10 @@ namespace greaper
 	{
 		SetWorkerCount(0);
 
-		for (auto& task : m_TaskSlots)
-		{
-			if (task.State == SlimTask::READY && task.Task != nullptr)
-				task.Task();
-
-			task.Task = nullptr;
-			task.State = SlimTask::DONE;
-		}
-		
-		//for (auto* task : m_TaskQueue)
-		//{
-		//	(*task)();
-		//	Destroy(task);
-		//}
-		//m_TaskQueue.clear();
-		//for (auto* task : m_FreeTaskPool)
-		//	Dealloc(task);
+		// No workers left, run what was still scheduled
+		uint32 slotIdx;
+		while (m_ReadySlots.TryPop(slotIdx))
+			ExecuteSlot(slotIdx);
 	}
 
 	INLINE bool SlimTaskScheduler::AreThereAnyAvailableWorker() const noexcept
@@ -281,6 +226,8 @@ namespace greaper
 		,m_AllowGrowth(true)
 	{
 		VerifyNot(m_ThreadManager.expired(), "Trying to initialize a SlimTaskScheduler, but an expired ThreadManager was given.");
+		for (uint32 i = 0; i < TaskCapacity; ++i)
+			PushSlot(m_FreeSlots, i);
 		auto mgr = m_ThreadManager.lock();
 		mgr->GetActivationEvent().Connect(m_OnManagerActivation, [this](bool active, IInterface* oldInterface, const PInterface& newInterface) { OnManagerActivation(active, oldInterface, newInterface); });
 
@@ -296,99 +243,97 @@ namespace greaper
 
 	INLINE void SlimTaskScheduler::WorkerFn(SlimTaskScheduler& scheduler, sizet id) noexcept
 	{
+		uint32 slotIdx;
 		while (true)
 		{
-			uint32 prevHandledTask = 0;
-			SlimTask* task;
-			// Retrieve a task to do or check if we need to keep running
+			if (scheduler.m_ReadySlots.TryPop(slotIdx))
 			{
-				auto taskLck = UniqueLock<decltype(m_TaskQueueMutex)>(scheduler.m_TaskQueueMutex);
-				bool canWork = scheduler.CanWorkerContinueWorking(id);
-				
-				uint32 queuedTaskID;
-				// Wait for work or an stop request
-				while (!scheduler.IsAnyTaskReady(queuedTaskID, prevHandledTask) && canWork)
-				{
-					scheduler.m_TaskQueueSignal.wait(taskLck);
-					canWork = scheduler.CanWorkerContinueWorking(id);
-				}
+				scheduler.ExecuteSlot(slotIdx);
+				continue;
+			}
 
-				// Stop working
-				if (!canWork)
-					break;
-
-				// Retrieve one task
-				//if (!scheduler.IsTaskQueueEmpty())
-				//{
-				//	task = scheduler.m_TaskQueue.front();
-				//	scheduler.m_TaskQueue.pop_front();
-				//}
-				task = &scheduler.m_TaskSlots[queuedTaskID];
-				task->State = SlimTask::SCHEDULED; // Avoid re-scheduling
-				prevHandledTask = queuedTaskID;
+			// Nothing to do, announce that we are going to sleep and check again,
+			// a task pushed after this point will see us and increment the epoch
+			const uint32 epoch = scheduler.m_WorkEpoch.load();
+			scheduler.m_SleepingWorkers.fetch_add(1);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (scheduler.m_ReadySlots.TryPop(slotIdx))
+			{
+				scheduler.m_SleepingWorkers.fetch_sub(1);
+				scheduler.ExecuteSlot(slotIdx);
+				continue;
 			}
 
-			// Do actual task work, and store the task memory on the free pool
-			if (task != nullptr)
+			// Stop working
+			if (!scheduler.CanWorkerContinueWorking(id))
 			{
-				// Execute the task
-				task->Task();
-				scheduler.m_TaskQueueMutex.lock();
-				task->State = SlimTask::DONE;
-				task->Task = nullptr;
-				scheduler.m_TaskQueueMutex.unlock();
-				// all newly created tasks assume uninitialized memory so we need to call destructor now
-				//task->~packaged_task();
-				// Store the task on to the free task pool
-				//{
-				//	LOCK(scheduler.m_FreeTaskPoolMutex);
-				//	scheduler.m_FreeTaskPool.push_back(task);
-				//}
-
-				task = nullptr;
-				scheduler.m_TaskQueueSignal.notify_all();
+				scheduler.m_SleepingWorkers.fetch_sub(1);
+				break;
 			}
+
+			AtomicWait(scheduler.m_WorkEpoch, epoch);
+			scheduler.m_SleepingWorkers.fetch_sub(1);
 		}
 	}
-	
-	INLINE bool SlimTaskScheduler::IsTaskQueueEmpty()const noexcept
+
+	INLINE uint32 SlimTaskScheduler::AcquireFreeSlot() noexcept
 	{
-		LOCK(m_TaskQueueMutex);
-		for(const auto& slot : m_TaskSlots)
+		uint32 slotIdx;
+		while (!m_FreeSlots.TryPop(slotIdx))
 		{
-			if (slot.State != SlimTask::DONE && slot.Task != nullptr)
-				return false;
+			// All slots are in use, sleep until a worker releases one
+			const uint32 epoch = m_FreeSlotEpoch.load();
+			m_FreeSlotWaiters.fetch_add(1);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (m_FreeSlots.TryPop(slotIdx))
+			{
+				m_FreeSlotWaiters.fetch_sub(1);
+				break;
+			}
+			AtomicWait(m_FreeSlotEpoch, epoch);
+			m_FreeSlotWaiters.fetch_sub(1);
 		}
-		return true;
+		return slotIdx;
 	}
 
-	INLINE bool SlimTaskScheduler::IsAnyTaskReady(uint32& queueTaskID, uint32 prevHandledTask)const noexcept
+	INLINE void SlimTaskScheduler::ExecuteSlot(uint32 slotIdx) noexcept
 	{
-#define SLOT_CHECK()\
-const auto& slot = *it;\
-if (slot.State == SlimTask::READY && slot.Task != nullptr) {\
-	queueTaskID = static_cast<uint32>(std::distance(m_TaskSlots.begin(), it));\
-	return true;}
-
-		for (auto it = m_TaskSlots.begin() + prevHandledTask; it != m_TaskSlots.end(); ++it)
-		{
-			SLOT_CHECK();
-		}
-
-		for (auto it = m_TaskSlots.begin(); it != m_TaskSlots.begin() + prevHandledTask; ++it)
-		{
-			SLOT_CHECK();
-		}
+		auto& slot = m_TaskSlots[slotIdx];
+		slot.State = SlimTask::WORKING;
+		slot.Task();
+		slot.Task = nullptr;
+		slot.State = SlimTask::DONE;
+		slot.Generation.store((slot.Generation.load() + 1) & TaskIDGenerationMask);
+		if (slot.Waiters.load() > 0)
+			AtomicNotifyAll(slot.Generation);
+
+		// The slot can be reused now, its generation has already changed
+		PushSlot(m_FreeSlots, slotIdx);
+		WakeUp(m_FreeSlotEpoch, m_FreeSlotWaiters, false);
+
+		if (m_PendingTasks.fetch_sub(1) == 1 && m_FinishWaiters.load() > 0)
+			AtomicNotifyAll(m_PendingTasks);
+	}
 
-		return false;
+	INLINE void SlimTaskScheduler::PushSlot(SlotRing_t& ring, uint32 slotIdx) noexcept
+	{
+		// The rings can hold every slot, but a push may still find its cell being
+		// released by a consumer that hasn't finished yet, just wait for it
+		while (!ring.TryPush(slotIdx))
+			THREAD_YIELD();
 	}
 
-	INLINE bool SlimTaskScheduler::IsNextTaskAvailable()const noexcept
+	INLINE void SlimTaskScheduler::WakeUp(std::atomic<uint32>& epoch, const std::atomic<uint32>& sleepers, bool all) noexcept
 	{
-		uint32 taskIdx = m_LastTaskSlotUsed + 1;
-		if (taskIdx >= m_TaskSlots.size())
-			taskIdx = 0;
-		const auto& slot = m_TaskSlots[taskIdx];
-		return slot.Task == nullptr && slot.State == SlimTask::DONE;
+		// Pairs with the fence of the sleeper, either it sees our push or we see it sleeping
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (sleepers.load(std::memory_order_relaxed) == 0)
+			return;
+
+		epoch.fetch_add(1);
+		if (all)
+			AtomicNotifyAll(epoch);
+		else
+			AtomicNotifyOne(epoch);
 	}
-}
\ No newline at end of file
+}
@@ -0,0 +1,210 @@
+/***********************************************************************************
+*   Copyright 2022 Marcos Sánchez Torrent.                                         *
+*   All Rights Reserved.                                                           *
+***********************************************************************************/
+
+#pragma once
+
+//#include "../TaskGraph.h"
+
+namespace greaper
+{
+	INLINE TaskGraph::TaskGraph(StringView name) noexcept
+		:m_Name(name)
+	{
+
+	}
+
+	INLINE TaskGraph::~TaskGraph() noexcept
+	{
+		// Running nodes reference the graph
+		WaitUntilFinish();
+	}
+
+	inline TResult<TaskGraph::NodeID> TaskGraph::AddNode(StringView name, TaskFunction workFn) noexcept
+	{
+		if (workFn == nullptr)
+			return Result::CreateFailure<NodeID>(Format("Trying to add the node '%s' to the TaskGraph '%s' with a nullptr task.", name.data(), m_Name.c_str()));
+		if (IsRunning())
+			return Result::CreateFailure<NodeID>(Format("Trying to add the node '%s' to the TaskGraph '%s' while is running.", name.data(), m_Name.c_str()));
+
+		const auto id = (NodeID)m_Nodes.size();
+		auto& node = m_Nodes.emplace_back();
+		node.Name.assign(name);
+		node.WorkFn = std::move(workFn);
+		return Result::CreateSuccess(id);
+	}
+
+	inline EmptyResult TaskGraph::AddDependency(NodeID predecessor, NodeID successor) noexcept
+	{
+		if (predecessor >= m_Nodes.size() || successor >= m_Nodes.size())
+			return Result::CreateFailure(Format("Trying to add a dependency to the TaskGraph '%s' with an invalid node.", m_Name.c_str()));
+		if (predecessor == successor)
+			return Result::CreateFailure(Format("Trying to add a dependency to the TaskGraph '%s' from a node to itself.", m_Name.c_str()));
+		if (IsRunning())
+			return Result::CreateFailure(Format("Trying to add a dependency to the TaskGraph '%s' while is running.", m_Name.c_str()));
+
+		auto& successors = m_Nodes[predecessor].Successors;
+		if (Contains(successors, successor))
+			return Result::CreateSuccess();
+
+		successors.push_back(successor);
+		++m_Nodes[successor].PredecessorCount;
+		return Result::CreateSuccess();
+	}
+
+	inline EmptyResult TaskGraph::Dispatch(const PTaskScheduler& scheduler) noexcept
+	{
+		if (scheduler == nullptr)
+			return Result::CreateFailure(Format("Trying to dispatch the TaskGraph '%s' with a nullptr scheduler.", m_Name.c_str()));
+
+		auto wScheduler = (WTaskScheduler)scheduler;
+		return Launch([wScheduler](StringView name, TaskFunction workFn)
+			{
+				auto scheduler = wScheduler.lock();
+				if (scheduler == nullptr)
+					return false;
+				return scheduler->AddTask(name, std::move(workFn)).IsOk();
+			});
+	}
+
+	inline EmptyResult TaskGraph::Dispatch(const PSlimScheduler& scheduler) noexcept
+	{
+		if (scheduler == nullptr)
+			return Result::CreateFailure(Format("Trying to dispatch the TaskGraph '%s' with a nullptr scheduler.", m_Name.c_str()));
+
+		auto wScheduler = (WSlimScheduler)scheduler;
+		return Launch([wScheduler](UNUSED StringView name, TaskFunction workFn)
+			{
+				auto scheduler = wScheduler.lock();
+				if (scheduler == nullptr)
+					return false;
+				return scheduler->AddTask(std::move(workFn)).IsOk();
+			});
+	}
+
+	INLINE TaskState_t TaskGraph::GetNodeState(NodeID node) const noexcept
+	{
+		if (node >= m_Nodes.size())
+			return TaskState_t::Inactive;
+		return m_Nodes[node].State.load();
+	}
+
+	INLINE bool TaskGraph::IsRunning() const noexcept { return m_Running.load(); }
+
+	INLINE void TaskGraph::WaitUntilFinish() const noexcept
+	{
+		auto lck = UniqueLock<decltype(m_FinishedMutex)>(m_FinishedMutex);
+		while (m_Running.load())
+			m_FinishedSignal.wait(lck);
+	}
+
+	INLINE sizet TaskGraph::GetNodeCount() const noexcept { return m_Nodes.size(); }
+
+	INLINE const String& TaskGraph::GetName() const noexcept { return m_Name; }
+
+	inline EmptyResult TaskGraph::Launch(SubmitFn_t submit) noexcept
+	{
+		if (m_Running.exchange(true))
+			return Result::CreateFailure(Format("Trying to dispatch the TaskGraph '%s' while is running.", m_Name.c_str()));
+
+		if (m_Nodes.empty())
+		{
+			m_Running.store(false);
+			return Result::CreateSuccess();
+		}
+
+		if (HasCycles())
+		{
+			m_Running.store(false);
+			return Result::CreateFailure(Format("Trying to dispatch the TaskGraph '%s', but it has cyclic dependencies.", m_Name.c_str()));
+		}
+
+		m_Submit = std::move(submit);
+		m_RemainingNodes.store(m_Nodes.size());
+
+		Vector<NodeID> roots;
+		for (sizet i = 0; i < m_Nodes.size(); ++i)
+		{
+			auto& node = m_Nodes[i];
+			node.PendingPredecessors.store(node.PredecessorCount);
+			node.State.store(TaskState_t::Inactive);
+			if (node.PredecessorCount == 0)
+				roots.push_back((NodeID)i);
+		}
+
+		// Roots must be gathered before scheduling, as nodes start completing right away
+		for (auto root : roots)
+			Schedule(root);
+
+		return Result::CreateSuccess();
+	}
+
+	inline bool TaskGraph::HasCycles() const noexcept
+	{
+		// Kahn's algorithm, if some node never gets all its predecessors resolved there's a cycle
+		Vector<uint32> pending;
+		Vector<NodeID> ready;
+		pending.reserve(m_Nodes.size());
+		for (sizet i = 0; i < m_Nodes.size(); ++i)
+		{
+			pending.push_back(m_Nodes[i].PredecessorCount);
+			if (pending.back() == 0)
+				ready.push_back((NodeID)i);
+		}
+
+		sizet visited = 0;
+		while (!ready.empty())
+		{
+			const auto node = ready.back();
+			ready.pop_back();
+			++visited;
+			for (auto successor : m_Nodes[node].Successors)
+			{
+				if (--pending[successor] == 0)
+					ready.push_back(successor);
+			}
+		}
+		return visited != m_Nodes.size();
+	}
+
+	INLINE void TaskGraph::Schedule(NodeID node) noexcept
+	{
+		// If the scheduler cannot take it, run it here so the graph always finishes
+		if (!m_Submit(m_Nodes[node].Name, [this, node]() { RunNode(node); }))
+			RunNode(node);
+	}
+
+	inline void TaskGraph::RunNode(NodeID nodeID) noexcept
+	{
+		while (nodeID != InvalidNode)
+		{
+			auto& node = m_Nodes[nodeID];
+			node.State.store(TaskState_t::InProgress);
+			node.WorkFn();
+			node.State.store(TaskState_t::Completed);
+
+			// Release the successors, keep the first one to continue working on it
+			NodeID next = InvalidNode;
+			for (auto successor : node.Successors)
+			{
+				if (m_Nodes[successor].PendingPredecessors.fetch_sub(1) != 1)
+					continue;
+
+				if (next == InvalidNode)
+					next = successor;
+				else
+					Schedule(successor);
+			}
+
+			if (m_RemainingNodes.fetch_sub(1) == 1)
+			{
+				// Notify under the lock, the graph may be destroyed as soon as the waiters wake up
+				LOCK(m_FinishedMutex);
+				m_Running.store(false);
+				m_FinishedSignal.notify_all();
+			}
+			nodeID = next;
+		}
+	}
+}
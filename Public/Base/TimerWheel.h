@@ -0,0 +1,269 @@
+/***********************************************************************************
+*   Copyright 2022 Marcos Sánchez Torrent.                                         *
+*   All Rights Reserved.                                                           *
+***********************************************************************************/
+
+#pragma once
+
+#ifndef CORE_TIMER_WHEEL_H
+#define CORE_TIMER_WHEEL_H 1
+
+#include "../CorePrerequisites.h"
+
+namespace greaper
+{
+	/*** Intrusive hook of the timers stored on a TimerWheel */
+	struct TimerWheelNode
+	{
+		TimerWheelNode* Prev = nullptr;
+		TimerWheelNode* Next = nullptr;
+		uint64 DueTick = 0;
+		// Level * SlotCount + slot, only valid while linked
+		uint32 SlotIndex = 0;
+
+		NODISCARD bool IsLinked()const noexcept { return Next != nullptr; }
+	};
+
+	/*** Hierarchical timer wheel
+	*
+	*	Timers are kept on LevelCount wheels of SlotCount slots, each level
+	*	SlotCount times coarser than the previous one. Insert and Remove are
+	*	O(1), and Advance only visits occupied slots, timers of the higher
+	*	levels are moved down once their slot is reached. It doesn't know about
+	*	time nor threads, ticks are given by the user and it must be locked
+	*	externally. Delays longer than 2^36 ticks are supported, but they are
+	*	placed again each turn of the top level.
+	*/
+	class TimerWheel
+	{
+	public:
+		static constexpr uint32 SlotBits = 6;
+		static constexpr uint32 SlotCount = 1u << SlotBits;
+		static constexpr uint32 LevelCount = 6;
+
+		TimerWheel()noexcept;
+
+		TimerWheel(const TimerWheel&) = delete;
+		TimerWheel& operator=(const TimerWheel&) = delete;
+
+		NODISCARD bool IsEmpty()const noexcept;
+		NODISCARD sizet GetSize()const noexcept;
+
+		/*** Every timer due up to this tick has already expired */
+		NODISCARD uint64 GetCurrentTick()const noexcept;
+
+		/*** Ticks already passed expire on the next Advance */
+		void Insert(TimerWheelNode* node, uint64 dueTick)noexcept;
+
+		void Remove(TimerWheelNode* node)noexcept;
+
+		/*** Moves the wheel up to targetTick, unlinking and appending the expired timers to expired
+		*	Timers expire in tick order, but the ones of the same tick are not ordered.
+		*/
+		void Advance(uint64 targetTick, Vector<TimerWheelNode*>& expired)noexcept;
+
+		/*** Lower bound of the next tick Advance has something to do, UINT64_MAX when empty */
+		NODISCARD uint64 GetNextEventTick()const noexcept;
+
+		/*** Unlinks every timer, appending them to nodes */
+		void TakeAll(Vector<TimerWheelNode*>& nodes)noexcept;
+
+	private:
+		static constexpr uint32 TotalSlots = SlotCount * LevelCount;
+
+		// Circular lists, the slots are their sentinels
+		std::array<TimerWheelNode, TotalSlots> m_Slots;
+		std::array<uint64, LevelCount> m_Occupied{};
+		uint64 m_CurrentTick = 0;
+		sizet m_Size = 0;
+		Vector<TimerWheelNode*> m_Cascading;
+
+		void Place(TimerWheelNode* node)noexcept;
+		void Link(TimerWheelNode* node, uint32 slotIndex)noexcept;
+		void Unlink(TimerWheelNode* node)noexcept;
+
+		/*** Unlinks the timers of a slot, appending them to nodes */
+		void TakeSlot(uint32 slotIndex, Vector<TimerWheelNode*>& nodes)noexcept;
+		void Cascade()noexcept;
+
+		NODISCARD static uint32 GetLevelSlot(uint64 tick, uint32 level)noexcept;
+	};
+
+	INLINE TimerWheel::TimerWheel() noexcept
+	{
+		for (auto& slot : m_Slots)
+		{
+			slot.Prev = &slot;
+			slot.Next = &slot;
+		}
+	}
+
+	INLINE bool TimerWheel::IsEmpty() const noexcept { return m_Size == 0; }
+
+	INLINE sizet TimerWheel::GetSize() const noexcept { return m_Size; }
+
+	INLINE uint64 TimerWheel::GetCurrentTick() const noexcept { return m_CurrentTick; }
+
+	INLINE void TimerWheel::Insert(TimerWheelNode* node, uint64 dueTick) noexcept
+	{
+		VerifyNot(node->IsLinked(), "Trying to insert a timer which is already on a TimerWheel.");
+		node->DueTick = Max(dueTick, m_CurrentTick + 1);
+		Place(node);
+		++m_Size;
+	}
+
+	INLINE void TimerWheel::Remove(TimerWheelNode* node) noexcept
+	{
+		if (!node->IsLinked())
+			return;
+		Unlink(node);
+		--m_Size;
+	}
+
+	inline void TimerWheel::Advance(uint64 targetTick, Vector<TimerWheelNode*>& expired) noexcept
+	{
+		while (m_CurrentTick < targetTick)
+		{
+			// Nothing to visit, the slots stay valid wherever the wheel is
+			if (m_Size == 0)
+			{
+				m_CurrentTick = targetTick;
+				return;
+			}
+
+			const uint64 nextTick = m_CurrentTick + 1;
+			const uint32 slot = GetLevelSlot(nextTick, 0);
+			if (slot == 0)
+			{
+				// Start of a new turn, the higher levels may have something for it
+				m_CurrentTick = nextTick;
+				Cascade();
+				TakeSlot(0, expired);
+				continue;
+			}
+
+			// Jump to the next occupied slot of this turn, or right before the next slot of any level,
+			// no slot is crossed so the timers stay where they should
+			const uint64 pending = m_Occupied[0] & (~0ull << slot);
+			if (pending == 0)
+			{
+				m_CurrentTick = Min(GetNextEventTick() - 1, targetTick);
+				continue;
+			}
+			const uint64 slotTick = (nextTick & ~(uint64)(SlotCount - 1)) | CountTrailingZeros(pending);
+			if (slotTick > targetTick)
+			{
+				m_CurrentTick = targetTick;
+				return;
+			}
+			m_CurrentTick = slotTick;
+			TakeSlot(GetLevelSlot(slotTick, 0), expired);
+		}
+	}
+
+	inline uint64 TimerWheel::GetNextEventTick() const noexcept
+	{
+		if (m_Size == 0)
+			return std::numeric_limits<uint64>::max();
+
+		uint64 nextTick = std::numeric_limits<uint64>::max();
+		for (uint32 level = 0; level < LevelCount; ++level)
+		{
+			const uint64 occupied = m_Occupied[level];
+			if (occupied == 0)
+				continue;
+
+			// Rotate so bit 0 is the slot after the current one, the current slot is a whole turn away
+			const uint32 shift = (GetLevelSlot(m_CurrentTick, level) + 1) & (SlotCount - 1);
+			const uint64 rotated = shift == 0 ? occupied : ((occupied >> shift) | (occupied << (SlotCount - shift)));
+			const uint64 distance = (uint64)CountTrailingZeros(rotated) + 1;
+			const uint32 levelShift = level * SlotBits;
+			const uint64 slotTick = ((m_CurrentTick >> levelShift) + distance) << levelShift;
+			nextTick = Min(nextTick, slotTick);
+		}
+		return nextTick;
+	}
+
+	inline void TimerWheel::TakeAll(Vector<TimerWheelNode*>& nodes) noexcept
+	{
+		for (uint32 i = 0; i < TotalSlots; ++i)
+		{
+			auto& sentinel = m_Slots[i];
+			while (sentinel.Next != &sentinel)
+			{
+				auto* node = sentinel.Next;
+				Unlink(node);
+				nodes.push_back(node);
+			}
+		}
+		m_Size = 0;
+	}
+
+	INLINE void TimerWheel::Place(TimerWheelNode* node) noexcept
+	{
+		// The level is given by the highest chunk of bits where the due tick differs from the current one
+		const uint64 diff = node->DueTick ^ m_CurrentTick;
+		// Beyond the top level the slot is reached up to a turn earlier than due, then it's placed again
+		const uint32 level = diff == 0 ? 0 : Min(FloorLog2(diff) / SlotBits, LevelCount - 1);
+		Link(node, level * SlotCount + GetLevelSlot(node->DueTick, level));
+	}
+
+	INLINE void TimerWheel::Link(TimerWheelNode* node, uint32 slotIndex) noexcept
+	{
+		auto& sentinel = m_Slots[slotIndex];
+		node->SlotIndex = slotIndex;
+		node->Prev = sentinel.Prev;
+		node->Next = &sentinel;
+		sentinel.Prev->Next = node;
+		sentinel.Prev = node;
+		m_Occupied[slotIndex / SlotCount] |= 1ull << (slotIndex % SlotCount);
+	}
+
+	INLINE void TimerWheel::Unlink(TimerWheelNode* node) noexcept
+	{
+		node->Prev->Next = node->Next;
+		node->Next->Prev = node->Prev;
+		node->Prev = nullptr;
+		node->Next = nullptr;
+		const auto& sentinel = m_Slots[node->SlotIndex];
+		if (sentinel.Next == &sentinel)
+			m_Occupied[node->SlotIndex / SlotCount] &= ~(1ull << (node->SlotIndex % SlotCount));
+	}
+
+	INLINE void TimerWheel::TakeSlot(uint32 slotIndex, Vector<TimerWheelNode*>& nodes) noexcept
+	{
+		auto& sentinel = m_Slots[slotIndex];
+		while (sentinel.Next != &sentinel)
+		{
+			auto* node = sentinel.Next;
+			Unlink(node);
+			nodes.push_back(node);
+			--m_Size;
+		}
+	}
+
+	inline void TimerWheel::Cascade() noexcept
+	{
+		// Each level is visited once the lower ones have completed a turn
+		for (uint32 level = 1; level < LevelCount; ++level)
+		{
+			const uint32 slot = GetLevelSlot(m_CurrentTick, level);
+			// Taken first, a timer far away may go back to the same slot
+			m_Cascading.clear();
+			TakeSlot(level * SlotCount + slot, m_Cascading);
+			m_Size += m_Cascading.size();
+			// Due right now goes to the slot 0 of the first level, which is taken after the cascade
+			for (auto* node : m_Cascading)
+				Place(node);
+			if (slot != 0)
+				break;
+		}
+	}
+
+	INLINE uint32 TimerWheel::GetLevelSlot(uint64 tick, uint32 level) noexcept
+	{
+		return (uint32)(tick >> (level * SlotBits)) & (SlotCount - 1);
+	}
+}
+
+#endif /* CORE_TIMER_WHEEL_H */
@@ -8,6 +8,9 @@
 #include <cstring>
 #include <type_traits>
 #include <tuple>
+#if COMPILER_MSVC
+#include <intrin.h>
+#endif
 
 /** Checks if a value is within range [min,max) */
 template<typename T>
@@ -41,6 +44,28 @@ NODISCARD INLINE constexpr uint32 BitsLog2(uint32 v)
 		return 3;
 	};
 }
+/** Index of the highest set bit, value must not be zero */
+NODISCARD INLINE uint32 FloorLog2(uint64 value)
+{
+#if COMPILER_MSVC
+	unsigned long index;
+	_BitScanReverse64(&index, value);
+	return (uint32)index;
+#else
+	return 63u - (uint32)__builtin_clzll(value);
+#endif
+}
+/** Index of the lowest set bit, value must not be zero */
+NODISCARD INLINE uint32 CountTrailingZeros(uint64 value)
+{
+#if COMPILER_MSVC
+	unsigned long index;
+	_BitScanForward64(&index, value);
+	return (uint32)index;
+#else
+	return (uint32)__builtin_ctzll(value);
+#endif
+}
 /** Checks if a number is a power of two */
 template<typename T>
 NODISCARD INLINE constexpr bool IsPowerOfTwo(const T value)
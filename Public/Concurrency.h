@@ -344,7 +344,7 @@ namespace greaper
 	class TSpinLock<true>
 	{
 		static constexpr uint32 SpinCount = 4000;
-		std::atomic_flag m_Lock;
+		std::atomic_flag m_Lock = ATOMIC_FLAG_INIT;
 
 	public:
 		TSpinLock() noexcept = default;
@@ -394,6 +394,38 @@ namespace greaper
 	using SpinLock = TSpinLock<true>;
 	using SpinLockDisabled = TSpinLock<false>;
 
+	/*** Sleeps while atom holds the expected value, similar to C++20 std::atomic::wait
+	*
+	*	Uses the OS address waiting (futex on Linux, WaitOnAddress on Windows),
+	*	so there's no mutex involved, a notify must follow every store that
+	*	a waiter could be waiting on. Spurious wake ups may happen.
+	*/
+	INLINE void AtomicWait(std::atomic<uint32>& atom, uint32 expected) noexcept
+	{
+		static_assert(sizeof(std::atomic<uint32>) == sizeof(uint32), "AtomicWait requires lock-free 32bit atomics.");
+		while (atom.load(std::memory_order_acquire) == expected)
+			Impl::AddressWaitImpl::Wait(reinterpret_cast<volatile uint32*>(&atom), expected);
+	}
+
+	/*** Same as AtomicWait but gives up after millis, returns false on timeout */
+	INLINE bool AtomicWaitFor(std::atomic<uint32>& atom, uint32 expected, uint32 millis) noexcept
+	{
+		if (atom.load(std::memory_order_acquire) != expected)
+			return true;
+		Impl::AddressWaitImpl::WaitFor(reinterpret_cast<volatile uint32*>(&atom), expected, millis);
+		return atom.load(std::memory_order_acquire) != expected;
+	}
+
+	INLINE void AtomicNotifyOne(std::atomic<uint32>& atom) noexcept
+	{
+		Impl::AddressWaitImpl::WakeOne(reinterpret_cast<volatile uint32*>(&atom));
+	}
+
+	INLINE void AtomicNotifyAll(std::atomic<uint32>& atom) noexcept
+	{
+		Impl::AddressWaitImpl::WakeAll(reinterpret_cast<volatile uint32*>(&atom));
+	}
+
 	struct AdoptLock { constexpr explicit AdoptLock()noexcept = default; };
 	struct DeferLock { constexpr explicit DeferLock()noexcept = default; };
 	struct TryToLock { constexpr explicit TryToLock()noexcept = default; };
@@ -52,6 +52,9 @@ namespace greaper
 	template<class... Args> class Event;
 	class MPMCTaskScheduler; using PTaskScheduler = SPtr<MPMCTaskScheduler>; using WTaskScheduler = WPtr<MPMCTaskScheduler>;
 	class SlimTaskScheduler; using PSlimScheduler = SPtr<SlimTaskScheduler>; using WSlimScheduler = WPtr<SlimTaskScheduler>;
+	// Task callables are stored inline, big enough for the usual captures (a few pointers plus a String or a SPtr)
+	static constexpr sizet TaskFunctionInlineSize = 96;
+	using TaskFunction = InlineFunction<void(), TaskFunctionInlineSize>;
 
 	class IStream;
 	class Uuid;
@@ -0,0 +1,222 @@
+/***********************************************************************************
+*   Copyright 2022 Marcos Sánchez Torrent.                                         *
+*   All Rights Reserved.                                                           *
+***********************************************************************************/
+
+#pragma once
+
+#ifndef CORE_COROUTINE_H
+#define CORE_COROUTINE_H 1
+
+#include "MPMCTaskScheduler.h"
+
+#if GREAPER_ENABLE_COROUTINES
+
+#include <coroutine>
+#include <optional>
+
+namespace greaper
+{
+	template<class T = void>
+	class CoTask;
+
+	namespace Impl
+	{
+		class CoPromiseBase
+		{
+		public:
+			/*** Resumes the awaiting coroutine, if any, on the same thread */
+			struct FinalAwaiter
+			{
+				bool await_ready()const noexcept { return false; }
+
+				template<class Promise>
+				std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle)noexcept;
+
+				void await_resume()const noexcept {}
+			};
+
+			static void* operator new(sizet size);
+			static void operator delete(void* ptr)noexcept;
+
+			std::suspend_always initial_suspend()const noexcept { return {}; }
+			FinalAwaiter final_suspend()const noexcept { return {}; }
+			void unhandled_exception()const noexcept;
+
+			void SetContinuation(std::coroutine_handle<> continuation)noexcept;
+
+		private:
+			std::coroutine_handle<> m_Continuation;
+		};
+
+		template<class T>
+		class CoPromise : public CoPromiseBase
+		{
+		public:
+			CoTask<T> get_return_object()noexcept;
+
+			template<class U>
+			void return_value(U&& value)noexcept;
+
+			T TakeResult()noexcept;
+
+		private:
+			std::optional<T> m_Value;
+		};
+
+		template<>
+		class CoPromise<void> : public CoPromiseBase
+		{
+		public:
+			CoTask<void> get_return_object()noexcept;
+
+			void return_void()const noexcept {}
+
+			void TakeResult()const noexcept {}
+		};
+
+		/*** Fire and forget coroutine, its frame is released once it finishes */
+		struct CoDetached
+		{
+			struct promise_type
+			{
+				static void* operator new(sizet size);
+				static void operator delete(void* ptr)noexcept;
+
+				CoDetached get_return_object()const noexcept { return {}; }
+				std::suspend_never initial_suspend()const noexcept { return {}; }
+				std::suspend_never final_suspend()const noexcept { return {}; }
+				void return_void()const noexcept {}
+				void unhandled_exception()const noexcept;
+			};
+		};
+
+		class HTaskAwaiter
+		{
+		public:
+			explicit HTaskAwaiter(HTask hTask)noexcept;
+
+			bool await_ready()const noexcept;
+			bool await_suspend(std::coroutine_handle<> handle)noexcept;
+			void await_resume()const noexcept {}
+
+		private:
+			HTask m_Task;
+		};
+
+		class SchedulerAwaiter
+		{
+		public:
+			SchedulerAwaiter(PTaskScheduler scheduler, TaskPriority_t priority)noexcept;
+
+			bool await_ready()const noexcept { return false; }
+			bool await_suspend(std::coroutine_handle<> handle)noexcept;
+			void await_resume()const noexcept {}
+
+		private:
+			PTaskScheduler m_Scheduler;
+			TaskPriority_t m_Priority;
+		};
+
+		class DelayAwaiter
+		{
+		public:
+			DelayAwaiter(PTaskScheduler scheduler, Duration_t delay, TaskPriority_t priority)noexcept;
+
+			bool await_ready()const noexcept { return m_Delay <= Duration_t::zero(); }
+			bool await_suspend(std::coroutine_handle<> handle)noexcept;
+			void await_resume()const noexcept {}
+
+		private:
+			PTaskScheduler m_Scheduler;
+			Duration_t m_Delay;
+			TaskPriority_t m_Priority;
+		};
+
+		/*** co_await hTask suspends until the task finishes, and resumes on the worker that finished it */
+		HTaskAwaiter operator co_await(const HTask& hTask)noexcept;
+
+		template<class T>
+		CoDetached RunDetached(PTaskScheduler scheduler, CoTask<T> task, TaskPriority_t priority)noexcept;
+
+		template<class T>
+		CoDetached RunAndNotify(PTaskScheduler scheduler, CoTask<T> task, std::optional<T>& result, Mutex& mutex, Signal& signal, bool& finished)noexcept;
+
+		CoDetached RunAndNotify(PTaskScheduler scheduler, CoTask<void> task, Mutex& mutex, Signal& signal, bool& finished)noexcept;
+	}
+
+	/*** Lazy coroutine which gives its result with co_await
+	*
+	*	It doesn't start until awaited, and once finished the awaiting
+	*	coroutine continues on the same thread. None of the awaitables of this
+	*	file block a thread: co_await of an HTask, ResumeOn and Delay suspend
+	*	the coroutine and resume it later on an MPMCTaskScheduler worker, so
+	*	workers are never pinned waiting as with HTask::WaitUntilFinish.
+	*	Use Spawn or SyncWait to start a CoTask from regular code.
+	*	Named CoTask so it doesn't collide with the scheduler tasks.
+	*/
+	template<class T>
+	class CoTask
+	{
+	public:
+		using promise_type = Impl::CoPromise<T>;
+
+		struct Awaiter
+		{
+			std::coroutine_handle<promise_type> Handle;
+
+			bool await_ready()const noexcept { return Handle.done(); }
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting)noexcept;
+			T await_resume()noexcept { return Handle.promise().TakeResult(); }
+		};
+
+		constexpr CoTask()noexcept = default;
+		CoTask(CoTask&& other)noexcept;
+		CoTask& operator=(CoTask&& other)noexcept;
+		~CoTask()noexcept;
+
+		CoTask(const CoTask&) = delete;
+		CoTask& operator=(const CoTask&) = delete;
+
+		NODISCARD bool IsValid()const noexcept;
+		NODISCARD bool IsDone()const noexcept;
+
+		Awaiter operator co_await()noexcept;
+
+	private:
+		std::coroutine_handle<promise_type> m_Handle;
+
+		explicit CoTask(std::coroutine_handle<promise_type> handle)noexcept;
+
+		friend promise_type;
+	};
+
+	/*** co_await ResumeOn(scheduler) continues the coroutine on a worker of scheduler
+	*	If the scheduler can't take it, it continues right away on the current thread.
+	*/
+	Impl::SchedulerAwaiter ResumeOn(PTaskScheduler scheduler, TaskPriority_t priority = TaskPriority_t::Normal)noexcept;
+
+	/*** co_await Delay(scheduler, delay) continues the coroutine on a worker of scheduler once delay has passed
+	*	If the scheduler can't take it, it continues right away on the current thread.
+	*/
+	Impl::DelayAwaiter Delay(PTaskScheduler scheduler, Duration_t delay, TaskPriority_t priority = TaskPriority_t::Normal)noexcept;
+
+	/*** Starts task on a worker of scheduler without waiting for it */
+	template<class T>
+	EmptyResult Spawn(const PTaskScheduler& scheduler, CoTask<T> task, TaskPriority_t priority = TaskPriority_t::Normal)noexcept;
+
+	/*** Runs task on a worker of scheduler, blocking the calling thread until it finishes
+	*	Meant for threads outside of the scheduler, a worker calling it is pinned
+	*	as with HTask::WaitUntilFinish.
+	*/
+	template<class T>
+	TResult<T> SyncWait(const PTaskScheduler& scheduler, CoTask<T> task)noexcept;
+
+	EmptyResult SyncWait(const PTaskScheduler& scheduler, CoTask<void> task)noexcept;
+}
+
+#include "Base/Coroutine.inl"
+
+#endif /* GREAPER_ENABLE_COROUTINES */
+
+#endif /* CORE_COROUTINE_H */
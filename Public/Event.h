@@ -38,7 +38,7 @@ namespace greaper
 	template<class... Args>
 	struct EventHandlerID
 	{
-		using HandlerFunction = std::function<void(Args...)>;
+		using HandlerFunction = InlineFunction<void(Args...)>;
 		HandlerFunction Function;
 		uint32 ID = 0;
 	};
@@ -46,7 +46,7 @@ namespace greaper
 	template<>
 	struct EventHandlerID<void>
 	{
-		using HandlerFunction = std::function<void()>;
+		using HandlerFunction = InlineFunction<void()>;
 		HandlerFunction Function;
 		uint32 ID = 0;
 	};
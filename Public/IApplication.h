@@ -29,6 +29,7 @@ namespace greaper
 	*	- CompilationInfo -> Stores information about the configuration of the compilation, inmutable static
 	*	- ApplicationVersion -> Stores the version of the Application, mutable static
 	*	- LoadedLibraries -> Stores a list of the loaded libraries, mutable static
+	*	- SIMDLevelOverride -> Forces the SIMD level of the dispatched kernels, empty for the best supported one, mutable static
 	*	- UpdateMaxRate -> Stores the maximum amount of updates per second, mutable external
 	*	- FixedUpdateMaxRate -> Stores the amount of fixed updates per second, mutable external
 	*/
@@ -44,6 +45,7 @@ namespace greaper
 		DEF_PROP(CompilationInfo, String);
 		DEF_PROP(ApplicationVersion, uint32);
 		DEF_PROP(LoadedLibraries, StringVec);
+		DEF_PROP(SIMDLevelOverride, String);
 		
 		using OnInterfaceActivationEvent_t = Event<const PInterface&>;
 
@@ -95,6 +97,8 @@ namespace greaper
 
 		virtual WPtr<CommandLineProp_t> GetCommandLine()const noexcept = 0;
 
+		virtual WPtr<SIMDLevelOverrideProp_t> GetSIMDLevelOverride()const noexcept = 0;
+
 		virtual Vector<PGreaperLib> GetRegisteredLibrariesCopy()const noexcept = 0;
 
 		virtual Vector<PInterface> GetActiveInterfacesCopy()const noexcept = 0;
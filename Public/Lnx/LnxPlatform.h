@@ -32,10 +32,19 @@ namespace greaper
 
 		static Vector<String> CreateSelectDirectoryDialog(StringView title, StringView defaultPath = ""sv, bool multiselect = false);
 
+		/*** Reads a list of CPUs as given by sysfs, like "0-7,16-23", returns false if it couldn't or it was empty */
+		static bool ReadCPUList(const achar* path, Vector<uint32>& cpus)noexcept;
+
 	protected:
 		static void _PerThreadInit();
 
 		static void _PerLibraryInit();
+
+		/*** Fills the topology from /sys/devices/system */
+		static void _InitCPUTopology(CPUTopology& topology)noexcept;
+
+	private:
+		static bool ReadSysValue(const achar* path, uint32& value)noexcept;
 	};
 }
 
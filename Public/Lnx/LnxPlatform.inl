@@ -36,4 +36,113 @@ INLINE void greaper::LnxOSPlatform::_PerThreadInit()
 INLINE void greaper::LnxOSPlatform::_PerLibraryInit()
 {
 
-}
\ No newline at end of file
+}
+
+INLINE bool greaper::LnxOSPlatform::ReadCPUList(const achar* path, Vector<uint32>& cpus) noexcept
+{
+	cpus.clear();
+	FILE* file = fopen(path, "r");
+	if (file == nullptr)
+		return false;
+
+	uint32 first = 0, last = 0;
+	int read;
+	while ((read = fscanf(file, "%u-%u", &first, &last)) >= 1)
+	{
+		if (read == 1)
+			last = first;
+		for (uint32 cpu = first; cpu <= last; ++cpu)
+			cpus.push_back(cpu);
+		if (fgetc(file) != ',')
+			break;
+	}
+	fclose(file);
+	return !cpus.empty();
+}
+
+INLINE bool greaper::LnxOSPlatform::ReadSysValue(const achar* path, uint32& value) noexcept
+{
+	FILE* file = fopen(path, "r");
+	if (file == nullptr)
+		return false;
+
+	// Sizes come with a unit, like "32K"
+	achar unit = '\0';
+	const int read = fscanf(file, "%u%c", &value, &unit);
+	fclose(file);
+	if (read < 1)
+		return false;
+	if (unit == 'K')
+		value *= 1024;
+	else if (unit == 'M')
+		value *= 1024 * 1024;
+	return true;
+}
+
+inline void greaper::LnxOSPlatform::_InitCPUTopology(CPUTopology& topology) noexcept
+{
+	Vector<uint32> online;
+	if (!ReadCPUList("/sys/devices/system/cpu/online", online))
+		return;
+	topology.LogicalCoreCount = (uint32)online.size();
+
+	achar path[128];
+	Vector<uint32> cpus;
+	Vector<uint32> packages;
+	for (const auto cpu : online)
+	{
+		snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/topology/thread_siblings_list", cpu);
+		if (ReadCPUList(path, cpus) && std::find(topology.SMTSiblings.begin(), topology.SMTSiblings.end(), cpus) == topology.SMTSiblings.end())
+			topology.SMTSiblings.push_back(cpus);
+
+		uint32 package = 0;
+		snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/topology/physical_package_id", cpu);
+		if (ReadSysValue(path, package) && std::find(packages.begin(), packages.end(), package) == packages.end())
+			packages.push_back(package);
+
+		for (uint32 index = 0; ; ++index)
+		{
+			CPUCacheInfo cache;
+			snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cache/index%u/level", cpu, index);
+			if (!ReadSysValue(path, cache.Level))
+				break;
+
+			snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cache/index%u/type", cpu, index);
+			FILE* file = fopen(path, "r");
+			if (file != nullptr)
+			{
+				achar type[16]{};
+				if (fscanf(file, "%15s", type) == 1)
+					cache.Type = strcmp(type, "Data") == 0 ? CPUCacheType_t::DATA : (strcmp(type, "Instruction") == 0 ? CPUCacheType_t::INSTRUCTION : CPUCacheType_t::UNIFIED);
+				fclose(file);
+			}
+			snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cache/index%u/size", cpu, index);
+			ReadSysValue(path, cache.Size);
+			snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cache/index%u/coherency_line_size", cpu, index);
+			ReadSysValue(path, cache.LineSize);
+			snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cache/index%u/ways_of_associativity", cpu, index);
+			ReadSysValue(path, cache.Associativity);
+			snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cache/index%u/shared_cpu_list", cpu, index);
+			if (!ReadCPUList(path, cpus))
+				cpus = { cpu };
+
+			// Same instance for all the CPUs sharing it, only added once
+			topology.AddCacheInstance(cache, cpus);
+		}
+	}
+	topology.PackageCount = (uint32)packages.size();
+
+	Vector<uint32> nodes;
+	if (ReadCPUList("/sys/devices/system/node/online", nodes))
+	{
+		for (const auto node : nodes)
+		{
+			snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist", node);
+			if (!ReadCPUList(path, cpus))
+				continue;
+			if (topology.NUMANodes.size() <= node)
+				topology.NUMANodes.resize(node + 1);
+			topology.NUMANodes[node] = cpus;
+		}
+	}
+}
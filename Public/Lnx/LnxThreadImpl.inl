@@ -22,6 +22,10 @@ namespace greaper
         std::function<void()> m_ThreadFn;
         bool m_JoinsAtDestruction;
         String m_Name;
+		ThreadAffinityMask m_Affinity;
+		ThreadSchedulingPolicy_t m_SchedulingPolicy;
+		int32 m_SchedulingPriority;
+		int32 m_PreferredNUMANode;
 		IInterface::ActivationEvt_t::HandlerType m_OnManagerActivation;
 		IApplication::OnInterfaceActivationEvent_t::HandlerType m_OnNewManager;
 		PThread m_This;
@@ -34,6 +38,9 @@ namespace greaper
 			if (lnxThread == nullptr)
 				return nullptr;
 
+			// From the thread itself, so the memory policy applies to it and it's placed before running any work
+			lnxThread->ApplyPlacement();
+
 			if(!lnxThread->m_Manager.expired())
 			{
 				auto mgr = lnxThread->m_Manager.lock();
@@ -61,6 +68,73 @@ namespace greaper
 			return nullptr;
 		}
 
+		static INLINE bool GetNUMANodeCPUs(int32 node, ThreadAffinityMask& cpus)noexcept
+		{
+			char path[64];
+			snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+			Vector<uint32> cpuList;
+			if (!LnxOSPlatform::ReadCPUList(path, cpuList))
+				return false;
+			for (const auto cpu : cpuList)
+			{
+				if (cpu < MaxThreadAffinityCPUs)
+					cpus.set(cpu);
+			}
+			return cpus.any();
+		}
+
+		INLINE void ApplyPlacement()noexcept
+		{
+			ThreadAffinityMask affinity = m_Affinity;
+			if (m_PreferredNUMANode >= 0)
+			{
+				// The kernel keeps allocating from the other nodes once this one is full
+				constexpr sizet maxNodes = 1024;
+				constexpr sizet bitsPerWord = sizeof(unsigned long) * 8;
+				unsigned long nodeMask[maxNodes / bitsPerWord]{};
+				if ((sizet)m_PreferredNUMANode < maxNodes)
+				{
+					nodeMask[m_PreferredNUMANode / bitsPerWord] = 1ul << (m_PreferredNUMANode % bitsPerWord);
+					if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, nodeMask, maxNodes + 1) != 0)
+						DEBUG_OUTPUT(Format("set_mempolicy() failed for the NUMA node %d, error code " I32_HEX_FMT, m_PreferredNUMANode, errno).c_str());
+				}
+				if (affinity.none() && !GetNUMANodeCPUs(m_PreferredNUMANode, affinity))
+					DEBUG_OUTPUT(Format("Couldn't retrieve the CPUs of the NUMA node %d.", m_PreferredNUMANode).c_str());
+			}
+
+			if (affinity.any())
+			{
+				cpu_set_t cpuSet;
+				CPU_ZERO(&cpuSet);
+				for (sizet cpu = 0; cpu < Min(MaxThreadAffinityCPUs, (sizet)CPU_SETSIZE); ++cpu)
+				{
+					if (affinity.test(cpu))
+						CPU_SET(cpu, &cpuSet);
+				}
+				const auto err = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+				if (err != 0)
+					DEBUG_OUTPUT(Format("pthread_setaffinity_np() failed, error code " I32_HEX_FMT, err).c_str());
+			}
+
+			if (m_SchedulingPolicy == ThreadSchedulingPolicy_t::Default)
+				return;
+
+			int policy = SCHED_OTHER;
+			switch (m_SchedulingPolicy)
+			{
+			case ThreadSchedulingPolicy_t::Batch: policy = SCHED_BATCH; break;
+			case ThreadSchedulingPolicy_t::Idle: policy = SCHED_IDLE; break;
+			case ThreadSchedulingPolicy_t::RoundRobin: policy = SCHED_RR; break;
+			case ThreadSchedulingPolicy_t::FIFO: policy = SCHED_FIFO; break;
+			default: break;
+			}
+			sched_param param{};
+			param.sched_priority = Clamp(m_SchedulingPriority, sched_get_priority_min(policy), sched_get_priority_max(policy));
+			const auto err = pthread_setschedparam(pthread_self(), policy, &param);
+			if (err != 0)
+				DEBUG_OUTPUT(Format("pthread_setschedparam() failed, error code " I32_HEX_FMT, err).c_str());
+		}
+
 		void OnManagerActivation(bool active, IInterface* oldManager, const PInterface& newManager)noexcept
 		{
 			if (active)
@@ -107,6 +181,10 @@ namespace greaper
             ,m_ThreadFn(config.ThreadFN)
             ,m_JoinsAtDestruction(config.JoinAtDestruction)
             ,m_Name(config.Name)
+			,m_Affinity(config.Affinity)
+			,m_SchedulingPolicy(config.SchedulingPolicy)
+			,m_SchedulingPriority(config.SchedulingPriority)
+			,m_PreferredNUMANode(config.PreferredNUMANode)
 			,m_This(std::move(self))
 			,m_Barrier(2)
 		{
@@ -149,6 +227,9 @@ namespace greaper
 			,m_ThreadFn(nullptr)
 			,m_JoinsAtDestruction(false)
 			,m_Name(name)
+			,m_SchedulingPolicy(ThreadSchedulingPolicy_t::Default)
+			,m_SchedulingPriority(0)
+			,m_PreferredNUMANode(-1)
 		{
 			if (setName)
 			{
@@ -179,6 +179,16 @@ namespace greaper
 
 		struct LnxSignalImpl
 		{
+			/*** pthread_cond_timedwait takes an absolute CLOCK_REALTIME time */
+			static timespec GetAbsoluteTime(uint32 millis) noexcept
+			{
+				const auto abs = std::chrono::system_clock::now().time_since_epoch() + std::chrono::milliseconds(millis);
+				const auto secs = std::chrono::duration_cast<std::chrono::seconds>(abs);
+				timespec t;
+				t.tv_sec = (time_t)secs.count();
+				t.tv_nsec = (long)std::chrono::duration_cast<std::chrono::nanoseconds>(abs - secs).count();
+				return t;
+			}
 			static bool IsValid(UNUSED const SignalHandle& handle) noexcept
 			{
 				return true;
@@ -218,11 +228,7 @@ namespace greaper
 			}
 			static bool WaitFor(SignalHandle& handle, MutexHandle& mutexHandle, uint32 millis) noexcept
 			{
-				timespec t;
-				const auto timePoint = Clock_t::now();
-				const auto nanos = (std::chrono::nanoseconds)std::chrono::milliseconds(millis);
-				const auto abs = (timePoint.time_since_epoch() + nanos).count();
-				t.tv_nsec = abs;
+				const auto t = GetAbsoluteTime(millis);
 				const auto rc = pthread_cond_timedwait(&handle, &mutexHandle, &t);
 				return rc == 0;
 			}
@@ -233,11 +239,7 @@ namespace greaper
 			}
 			static bool WaitForRecursive(SignalHandle& handle, RecursiveMutexHandle mutexHandle, uint32 millis) noexcept
 			{
-				timespec t;
-				const auto timePoint = Clock_t::now();
-				const auto nanos = (std::chrono::nanoseconds)std::chrono::milliseconds(millis);
-				const auto abs = (timePoint.time_since_epoch() + nanos).count();
-				t.tv_nsec = abs;
+				const auto t = GetAbsoluteTime(millis);
 				const auto rc = pthread_cond_timedwait(&handle, &mutexHandle, &t);
 				return rc == 0;
 			}
@@ -252,6 +254,31 @@ namespace greaper
 			}
 		};
 		using SignalImpl = LnxSignalImpl;
+
+		struct LnxAddressWaitImpl
+		{
+			static void Wait(volatile uint32* address, uint32 expected) noexcept
+			{
+				syscall(SYS_futex, address, FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+			}
+			static bool WaitFor(volatile uint32* address, uint32 expected, uint32 millis) noexcept
+			{
+				timespec t;
+				t.tv_sec = millis / 1000;
+				t.tv_nsec = (millis % 1000) * 1000000;
+				const auto rc = syscall(SYS_futex, address, FUTEX_WAIT_PRIVATE, expected, &t, nullptr, 0);
+				return rc == 0 || errno != ETIMEDOUT;
+			}
+			static void WakeOne(volatile uint32* address) noexcept
+			{
+				syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+			}
+			static void WakeAll(volatile uint32* address) noexcept
+			{
+				syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, INT32_MAX, nullptr, nullptr, 0);
+			}
+		};
+		using AddressWaitImpl = LnxAddressWaitImpl;
 	}
 }
 
@@ -14,6 +14,10 @@
 #include <utility>
 #include <uuid/uuid.h>
 #include <csignal>
+#include <cerrno>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <linux/mempolicy.h>
 
 struct LnxTypes : BasicTypes
 {
@@ -13,8 +13,13 @@
 #include "IApplication.h"
 #include "Base/IThread.h"
 #include "Enumeration.h"
+#include "Base/LatencyHistogram.h"
+#include "Base/TimerWheel.h"
+#include <thread>
 
-ENUMERATION(TaskState, Inactive, InProgress, Completed);
+ENUMERATION(TaskState, Inactive, InProgress, Completed, Cancelled);
+ENUMERATION(TaskSchedulerMode, SharedQueue, WorkStealing);
+ENUMERATION(TaskPriority, High, Normal, Background);
 
 namespace greaper
 {
@@ -23,26 +28,70 @@ namespace greaper
 		class Task
 		{
 		public:
-			constexpr Task()noexcept = default;
+			Task()noexcept = default;
 
 			NODISCARD TaskState_t GetCurrentState()const noexcept;
 
 			friend MPMCTaskScheduler;
+			friend class HTask;
+			friend class TaskLanes;
+			friend class CancellationToken;
 
 		private:
 			String m_Name{};
-			std::function<void()> m_WorkFn = nullptr;
-			TaskState_t m_State = TaskState_t::Inactive;
+			TaskFunction m_WorkFn = nullptr;
+			std::atomic<TaskState_t> m_State{ TaskState_t::Inactive };
+			TaskPriority_t m_Priority = TaskPriority_t::Normal;
+			Timepoint_t m_EnqueueTime{};
+			// Timepoint_t::max() when it has no deadline
+			Timepoint_t m_Deadline = Timepoint_t::max();
+			// Increased each time the task completes, waiters sleep on it until it changes
+			std::atomic<uint32> m_Generation{ 0 };
+			std::atomic<uint32> m_Waiters{ 0 };
+			// Called by the thread that completes the task, see HTask::AddContinuation
+			Vector<TaskFunction> m_Continuations;
+			// Also taken to cancel, so the generation can't change meanwhile
+			SpinLock m_ContinuationsLock;
+			// Set when cancelled while running, the body may poll it through a CancellationToken
+			std::atomic_bool m_CancelRequested{ false };
+			// Last generation that ended cancelled, so finished handles can still tell it
+			std::atomic<uint32> m_CancelledGeneration{ std::numeric_limits<uint32>::max() };
+			// A cancelled task is recycled by the second of its canceller and the worker that pops it
+			std::atomic<uint32> m_CancelReleases{ 0 };
+
+			void Complete(TaskState_t finalState)noexcept;
+		};
+
+		/*** Lets a running task body know that its task has been cancelled
+		*	Cheap to copy and to poll, the body is expected to return early once
+		*	IsCancellationRequested is true. Default constructed tokens are never cancelled.
+		*/
+		class CancellationToken
+		{
+			WTaskScheduler m_Scheduler;
+			Task* m_Task = nullptr;
+			uint32 m_Generation = 0;
+
+			friend MPMCTaskScheduler;
+			friend class HTask;
+
+			CancellationToken(Task* task, uint32 generation, WTaskScheduler scheduler)noexcept;
+
+		public:
+			constexpr CancellationToken()noexcept = default;
+
+			NODISCARD bool IsCancellationRequested()const noexcept;
 		};
 
 		class HTask
 		{
-			WPtr<Task> m_Task;
 			WTaskScheduler m_Scheduler;
+			Task* m_Task = nullptr;
+			uint32 m_Generation = 0;
 
 			friend MPMCTaskScheduler;
 
-			HTask(WPtr<Task> task, WTaskScheduler scheduler)noexcept;
+			HTask(Task* task, uint32 generation, WTaskScheduler scheduler)noexcept;
 
 		public:
 			constexpr HTask()noexcept = default;
@@ -54,14 +103,205 @@ namespace greaper
 			~HTask()noexcept = default;
 
 			void WaitUntilFinish()noexcept;
+
+			NODISCARD bool IsFinished()const noexcept;
+
+			/*** Cancelled is kept once finished, until the pooled task is cancelled again */
+			NODISCARD TaskState_t GetState()const noexcept;
+
+			/*** Cancels the task, see MPMCTaskScheduler::CancelTask */
+			bool Cancel()noexcept;
+
+			NODISCARD CancellationToken GetCancellationToken()const noexcept;
+
+			/*** Registers fn to be called by the thread that finishes the task, so no one has to wait for it
+			*	Returns false if the task has already finished, in that case fn is not stored.
+			*/
+			bool AddContinuation(TaskFunction fn)noexcept;
+		};
+
+		/*** Timer of a MPMCTaskScheduler, pooled so handles can check their generation */
+		struct Timer : TimerWheelNode
+		{
+			String Name{};
+			TaskFunction Callback = nullptr;
+			// Delayed tasks are posted as they are, instead of calling Callback
+			Task* TaskPtr = nullptr;
+			TaskPriority_t Priority = TaskPriority_t::Normal;
+			// Due tick before the slack is applied, repetitions are counted from it
+			uint64 ScheduledTick = 0;
+			uint64 PeriodTicks = 0;
+			uint64 SlackTicks = 0;
+			uint32 Generation = 0;
+			// Posted or running, so it's not on the wheel
+			bool Running = false;
+			bool Cancelled = false;
+		};
+
+		class HTimer
+		{
+			WTaskScheduler m_Scheduler;
+			Timer* m_Timer = nullptr;
+			uint32 m_Generation = 0;
+
+			friend MPMCTaskScheduler;
+
+			HTimer(Timer* timer, uint32 generation, WTaskScheduler scheduler)noexcept;
+
+		public:
+			constexpr HTimer()noexcept = default;
+
+			/*** Returns false if it had already finished or been cancelled, a running callback is not interrupted */
+			bool Cancel()noexcept;
+
+			/*** False once a one-shot timer has been called, or once cancelled */
+			NODISCARD bool IsActive()const noexcept;
+		};
+
+		/*** Growable circular buffer of tasks
+		*	Never shrinks, so once it has grown enough pushing and popping
+		*	don't allocate, which a Deque does every few tasks.
+		*/
+		class TaskRing
+		{
+		public:
+			NODISCARD bool IsEmpty()const noexcept;
+			NODISCARD sizet GetSize()const noexcept;
+
+			void PushBack(Task* task)noexcept;
+
+			/*** Allocates the initial buffer, if it wasn't already */
+			void Reserve()noexcept;
+
+			/*** Returns nullptr if empty */
+			NODISCARD Task* PeekFront()const noexcept;
+			/*** Returns nullptr if empty */
+			Task* PopFront()noexcept;
+			/*** Returns nullptr if empty */
+			Task* PopBack()noexcept;
+
+		private:
+			static constexpr sizet InitialCapacity = 64;
+
+			Vector<Task*> m_Buffer;
+			sizet m_Head = 0;
+			sizet m_Size = 0;
+
+			void Grow()noexcept;
+		};
+
+		/*** Task queue split in priority lanes
+		*	Tasks are served from the highest non-empty lane, but once the oldest
+		*	task of a lower lane has waited more than its aging limit it goes
+		*	first, so lower lanes never starve.
+		*	Tasks with a deadline are kept apart ordered by deadline, they go before
+		*	everything once their deadline is close, otherwise right after the High lane.
+		*/
+		class TaskLanes
+		{
+		public:
+			static constexpr std::chrono::microseconds DeadlineSlack{ 500 };
+			static constexpr std::chrono::microseconds AgingLimits[TaskPriority_t::COUNT]
+			{
+				std::chrono::microseconds{ 0 },		// High, never ages
+				std::chrono::microseconds{ 5000 },	// Normal
+				std::chrono::microseconds{ 50000 },	// Background
+			};
+
+			NODISCARD bool IsEmpty()const noexcept;
+			NODISCARD sizet GetSize()const noexcept;
+
+			void Push(Task* task)noexcept;
+
+			/*** Allocates the buffers of the lanes from the calling thread */
+			void Reserve()noexcept;
+
+			/*** Returns nullptr if empty, with newestFirst the lanes are popped in LIFO order */
+			Task* Pop(Timepoint_t now, bool newestFirst = false)noexcept;
+
+		private:
+			std::array<TaskRing, TaskPriority_t::COUNT> m_Lanes;
+			// Min-heap by deadline
+			Vector<Task*> m_DeadlineTasks;
+			sizet m_Size = 0;
+
+			Task* PopLane(sizet lane, bool newestFirst)noexcept;
+			Task* PopDeadline()noexcept;
+
+			static bool HasLaterDeadline(const Task* left, const Task* right)noexcept;
+		};
+
+		/*** Per-lane counters, ExecutedTasks is the latency count */
+		struct TaskLaneCounters
+		{
+			LatencyHistogram QueueLatency;
+			std::atomic<uint64> DeadlineMisses{ 0 };
+			std::atomic<uint64> CancelledTasks{ 0 };
+		};
+
+		/*** Per-worker task queue used by the WorkStealing mode
+		*	The owner worker pushes and pops from the back (LIFO) while the other
+		*	workers steal from the front (FIFO), each queue has its own lock so
+		*	workers only collide when stealing from the same victim.
+		*/
+		struct TaskWorkQueue
+		{
+			TaskLanes Tasks;
+			SpinLock Lock;
+			// Token of the worker that owns it, 0 once retired
+			std::atomic<uint64> Owner{ 0 };
+			uint8 _Padding[CACHE_LINE_SIZE]{};
 		};
 	}
 
+	struct TaskLaneStats
+	{
+		uint64 ExecutedTasks = 0;
+		uint64 DeadlineMisses = 0;
+		// Cancelled before a worker could start them
+		uint64 CancelledTasks = 0;
+		// Time spent on the queue, from AddTask until a worker picks the task
+		Duration_t QueueLatencyP50{};
+		Duration_t QueueLatencyP90{};
+		Duration_t QueueLatencyP99{};
+		Duration_t QueueLatencyMax{};
+	};
+
+	struct TaskSchedulerStats
+	{
+		std::array<TaskLaneStats, TaskPriority_t::COUNT> Lanes{};
+	};
+
+	/*** Auto-scaling policy of a MPMCTaskScheduler
+	*	A worker is added when a task has waited on the queue more than
+	*	ScaleUpLatency while there were more pending tasks than workers and none
+	*	of them was idle, at most one each ScaleUpLatency. Workers without work
+	*	for IdleTimeout retire by themselves, down to MinWorkers.
+	*/
+	struct TaskSchedulerScaling
+	{
+		bool Enabled = false;
+		sizet MinWorkers = 1;
+		sizet MaxWorkers = 1;
+		Duration_t ScaleUpLatency = std::chrono::milliseconds(2);
+		Duration_t IdleTimeout = std::chrono::seconds(5);
+	};
+
 	class MPMCTaskScheduler
 	{
 	public:
+		/*** Maximum amount of workers in WorkStealing mode */
+		static constexpr sizet MaxStealingWorkers = 256;
+
+		/*** Tick of the timer wheel, due times are rounded up to it */
+		static constexpr std::chrono::milliseconds TimerResolution{ 1 };
+
+		/*** With pinWorkers the worker i runs only on the logical CPU i, modulo the CPU count
+		*	In WorkStealing mode each worker also allocates its own queue, so it's
+		*	placed on the NUMA node of its CPU and the hot path doesn't cross sockets.
+		*/
 		template<class _Alloc_ = GenericAllocator>
-		static PTaskScheduler Create(WThreadManager threadMgr, StringView name, sizet workerCount, bool allowGrowth = true)noexcept;
+		static PTaskScheduler Create(WThreadManager threadMgr, StringView name, sizet workerCount, bool allowGrowth = true, TaskSchedulerMode_t mode = TaskSchedulerMode_t::SharedQueue, bool pinWorkers = false)noexcept;
 
 		~MPMCTaskScheduler()noexcept;
 
@@ -71,11 +311,48 @@ namespace greaper
 		sizet GetWorkerCount()const noexcept;
 		EmptyResult SetWorkerCount(sizet count)noexcept;
 
-		TResult<Impl::HTask> AddTask(StringView name, std::function<void()> workFn)noexcept;
+		TResult<Impl::HTask> AddTask(StringView name, TaskFunction workFn, TaskPriority_t priority = TaskPriority_t::Normal)noexcept;
+
+		/*** Adds a task that should start before the deadline, see Impl::TaskLanes */
+		TResult<Impl::HTask> AddTask(StringView name, TaskFunction workFn, TaskPriority_t priority, Timepoint_t deadline)noexcept;
+
+		/*** Adds a task that will be queued once the delay has passed
+		*	Delayed tasks are kept on the timer wheel, see AddTimer, they don't
+		*	count for WaitUntilAllTasksFinished until they are due.
+		*/
+		TResult<Impl::HTask> AddDelayedTask(StringView name, TaskFunction workFn, Duration_t delay, TaskPriority_t priority = TaskPriority_t::Normal)noexcept;
+
+		/*** Posts fn as a task once delay has passed, and then every period if it isn't zero
+		*
+		*	Timers are kept on a hierarchical TimerWheel of TimerResolution ticks,
+		*	driven by a single timer thread created on the first use, so adding and
+		*	cancelling are O(1) and no thread sleeps per timer. A timer may fire up
+		*	to slack later, which aligns it with the timers of nearby windows so
+		*	they are posted on the same wakeup and in a single batch. A repeating
+		*	timer is armed again once fn returns, period after its previous due
+		*	time, so it never overlaps with itself and missed periods are skipped.
+		*/
+		TResult<Impl::HTimer> AddTimer(StringView name, TaskFunction fn, Duration_t delay, Duration_t period = Duration_t::zero(), Duration_t slack = Duration_t::zero(), TaskPriority_t priority = TaskPriority_t::Normal)noexcept;
 
-		TResult<Vector<Impl::HTask>> AddTasks(const Vector<std::tuple<StringView, std::function<void()>>>& tasks)noexcept;
+		bool CancelTimer(const Impl::HTimer& hTimer)noexcept;
+
+		NODISCARD bool IsTimerActive(const Impl::HTimer& hTimer)const noexcept;
+
+		/*** Adds all the tasks at once, taking each lock once for the whole batch instead of once per task */
+		TResult<Vector<Impl::HTask>> AddTasks(const Vector<std::tuple<StringView, std::function<void()>>>& tasks, TaskPriority_t priority = TaskPriority_t::Normal)noexcept;
 
 		void WaitUntilTaskIsFinish(const Impl::HTask& hTask)noexcept;
+
+		/*** Cancels a task, returns true if it won't run
+		*	A queued or delayed task is finished right away, in O(1): its entry
+		*	stays on the queue and is dropped once a worker pops it. A running
+		*	task can't be stopped, it's flagged so its CancellationToken reports
+		*	it and ends as Cancelled, but false is returned.
+		*/
+		bool CancelTask(const Impl::HTask& hTask)noexcept;
+
+		/*** Token of the task running on the calling thread, an empty token outside of a task */
+		static Impl::CancellationToken GetCurrentCancellationToken()noexcept;
 		void WaitUntilAllTasksFinished()noexcept;
 
 		const String& GetName()const noexcept;
@@ -83,22 +360,103 @@ namespace greaper
 		bool IsGrowthEnabled()const noexcept;
 		void EnableGrowth(bool enable)noexcept;
 
+		TaskSchedulerMode_t GetMode()const noexcept;
+
+		bool IsWorkerPinningEnabled()const noexcept;
+
+		NODISCARD TaskSchedulerStats GetStats()const noexcept;
+		void ResetStats()noexcept;
+
+		/*** Sets the auto-scaling policy, workers are added only if growth is enabled */
+		EmptyResult SetScaling(const TaskSchedulerScaling& scaling)noexcept;
+		NODISCARD TaskSchedulerScaling GetScaling()const noexcept;
+
+		/*** Binds the scaling policy to properties of the ThreadManager library
+		*	<Name>_AutoScale, <Name>_MinWorkers, <Name>_MaxWorkers, <Name>_ScaleUpLatencyUs
+		*	and <Name>_IdleTimeoutMs are created, or reused if they exist, and any
+		*	change on them is applied right away.
+		*/
+		EmptyResult InitScalingProperties()noexcept;
+
 	private:
 		WThreadManager m_ThreadManager;
 		String m_Name;
 
 		Vector<PThread> m_TaskWorkers;
+		// Token of each worker, so a retired worker knows it even if its id gets reused
+		Vector<uint64> m_WorkerTokens;
+		uint64 m_NextWorkerToken = 0;
+		// Workers that have left or are about to, they are joined by SetWorkerCount
+		Vector<PThread> m_RetiredWorkers;
 		mutable RWMutex m_TaskWorkersMutex;
 
-		Deque<SPtr<Impl::Task>> m_TaskQueue;
+		Impl::TaskLanes m_TaskQueue;
 		mutable Mutex m_TaskQueueMutex;
 		Signal m_TaskQueueSignal;
+		// SharedQueue workers waiting on m_TaskQueueSignal, only modified under m_TaskQueueMutex
+		std::atomic<sizet> m_IdleWorkers{ 0 };
 
 		Vector<Impl::Task*> m_FreeTaskPool;
 		mutable Mutex m_FreeTaskPoolMutex;
 
+		// WorkStealing mode
+		std::array<std::atomic<Impl::TaskWorkQueue*>, MaxStealingWorkers> m_WorkQueues{};
+		std::atomic<sizet> m_WorkQueueCount{ 0 };
+		std::atomic<sizet> m_NextWorkQueue{ 0 };
+		std::atomic<sizet> m_QueuedTasks{ 0 };
+		std::atomic<sizet> m_SleepingWorkers{ 0 };
+		Mutex m_IdleMutex;
+		Signal m_IdleSignal;
+
+		std::atomic<sizet> m_PendingTasks{ 0 };
+		std::atomic<sizet> m_FinishWaiters{ 0 };
+		Mutex m_FinishedMutex;
+		Signal m_FinishedSignal;
+
+		std::array<Impl::TaskLaneCounters, TaskPriority_t::COUNT> m_LaneCounters;
+
+		// Timers and delayed tasks, guarded by m_TimerMutex
+		TimerWheel m_TimerWheel;
+		Vector<Impl::Timer*> m_FreeTimers;
+		Timepoint_t m_TimerEpoch;
+		// Tick until which the timer thread sleeps, 0 while it's awake
+		uint64 m_TimerWakeTick = 0;
+		PThread m_TimerThread;
+		bool m_TimerStopped = false;
+		mutable Mutex m_TimerMutex;
+		Signal m_TimerSignal;
+
+		// Auto-scaling, see TaskSchedulerScaling
+		std::atomic_bool m_AutoScale{ false };
+		std::atomic<sizet> m_MinWorkers{ 1 };
+		std::atomic<sizet> m_MaxWorkers{ 1 };
+		std::atomic<Duration_t::rep> m_ScaleUpLatency{ 0 };
+		std::atomic<Duration_t::rep> m_IdleTimeout{ 0 };
+		std::atomic<Duration_t::rep> m_LastScaleUp{ 0 };
+
+		enum ScalingProperties
+		{
+			AutoScaleProp,
+			MinWorkersProp,
+			MaxWorkersProp,
+			ScaleUpLatencyProp,
+			IdleTimeoutProp,
+
+			ScalingPropCount
+		};
+		std::array<WIProperty, ScalingPropCount> m_ScalingProps;
+		std::array<IProperty::ModificationEventHandler_t, ScalingPropCount> m_OnScalingPropChanged;
+
 		SPtr<MPMCTaskScheduler> m_This;
 		bool m_AllowGrowth;
+		TaskSchedulerMode_t m_Mode;
+		bool m_PinWorkers;
+
+		static inline thread_local MPMCTaskScheduler* tl_WorkerScheduler = nullptr;
+		static inline thread_local Impl::TaskWorkQueue* tl_WorkerQueue = nullptr;
+		static inline thread_local uint64 tl_WorkerToken = 0;
+		static inline thread_local MPMCTaskScheduler* tl_CurrentScheduler = nullptr;
+		static inline thread_local Impl::Task* tl_CurrentTask = nullptr;
 
 		IInterface::ActivationEvt_t::HandlerType m_OnManagerActivation;
 		IApplication::OnInterfaceActivationEvent_t::HandlerType m_OnNewManager;
@@ -110,11 +468,93 @@ namespace greaper
 
 		bool AreThereAnyAvailableWorker()const noexcept;
 		
-		MPMCTaskScheduler(WThreadManager threadMgr, StringView name, sizet workerCount, bool allowGrowth)noexcept;
+		MPMCTaskScheduler(WThreadManager threadMgr, StringView name, sizet workerCount, bool allowGrowth, TaskSchedulerMode_t mode, bool pinWorkers)noexcept;
+
+		bool CanWorkerContinueWorking(sizet workerID, uint64 token)const noexcept;
+
+		/*** Expects m_TaskWorkersMutex to be exclusively locked */
+		EmptyResult AddWorkers(sizet count)noexcept;
+
+		/*** Expects m_TaskWorkersMutex to be exclusively locked */
+		void RemoveLastWorker()noexcept;
+
+		/*** Called by an idle worker, only the last one can leave so the ids of the others stay valid */
+		bool TryRetireWorker(sizet workerID, uint64 token)noexcept;
+
+		void JoinRetiredWorkers()noexcept;
+
+		void WakeAllWorkers()noexcept;
+
+		void ConsiderScaleUp(Duration_t queueLatency, Timepoint_t now)noexcept;
+
+		Duration_t GetIdleTimeout()const noexcept;
+
+		void OnScalingPropertyChanged()noexcept;
+
+		template<class T>
+		static TResult<WProperty<T>> GetOrCreateProperty(const PGreaperLib& library, const String& name, T initialValue, StringView info)noexcept;
+
+		Impl::Task* AcquireTask()noexcept;
+
+		/*** Appends count tasks to tasks, locking the free pool only once */
+		void AcquireTasks(sizet count, Vector<Impl::Task*>& tasks)noexcept;
+
+		void PushTask(Impl::Task* task)noexcept;
+
+		void PushTasks(const Vector<Impl::Task*>& tasks)noexcept;
+
+		void ExecuteTask(Impl::Task* task, Timepoint_t dequeueTime)noexcept;
+
+		/*** Stores the task on the free pool and counts it as finished */
+		void RecycleTask(Impl::Task* task)noexcept;
+
+		/*** Called by both the canceller and the one that pops the task, returns true for the last one */
+		static bool ReleaseCancelledTask(Impl::Task* task)noexcept;
+
+		/*** Runs a task left on the queues while stopping, and destroys it */
+		static void RunAndDestroyTask(Impl::Task* task)noexcept;
+
+		void StopTimer()noexcept;
+
+		/*** Expects m_TimerMutex to be locked */
+		EmptyResult StartTimerThread()noexcept;
+
+		/*** Expects m_TimerMutex to be locked */
+		Impl::Timer* AcquireTimer()noexcept;
+
+		/*** Expects m_TimerMutex to be locked, the callback is given back so it can be released without the lock */
+		void ReleaseTimer(Impl::Timer* timer, TaskFunction& callback)noexcept;
+
+		/*** Expects m_TimerMutex to be locked, returns true if the timer thread has to be woken */
+		bool ArmTimer(Impl::Timer* timer, uint64 scheduledTick)noexcept;
+
+		uint64 GetTimerTick(Timepoint_t time, bool roundUp)const noexcept;
+
+		void PostTimers(Vector<Impl::Task*>& dueTasks, const Vector<Impl::Timer*>& dueTimers)noexcept;
+
+		void RunTimer(Impl::Timer* timer)noexcept;
+
+		void SubmitDueTasks(const Vector<Impl::Task*>& tasks)noexcept;
+
+		void OnTaskFinished()noexcept;
+
+		Impl::Task* PopLocalTask(Impl::TaskWorkQueue& queue, Timepoint_t now)noexcept;
+
+		Impl::Task* StealTask(sizet thiefID, Timepoint_t now)noexcept;
+
+		/*** Returns false if the idle timeout expired without work */
+		bool ParkWorker(Impl::TaskWorkQueue& queue, uint64 token)noexcept;
+
+		void WakeWorkers(sizet count)noexcept;
+
+		/*** Wakes count of the idle waiters of signal, with a single broadcast if that's all of them */
+		static void NotifyWorkers(Signal& signal, sizet count, sizet idle)noexcept;
+
+		static void WorkerFn(MPMCTaskScheduler& scheduler, sizet id, uint64 token)noexcept;
 
-		bool CanWorkerContinueWorking(sizet workerID)const noexcept;
+		static void StealingWorkerFn(MPMCTaskScheduler& scheduler, sizet id, uint64 token)noexcept;
 
-		static void WorkerFn(MPMCTaskScheduler& scheduler, sizet id)noexcept;
+		static void TimerFn(MPMCTaskScheduler& scheduler)noexcept;
 	};
 }
 
@@ -59,6 +59,7 @@ namespace greaper
 #include "Concurrency.h"
 
 #include "Allocators/PoolAllocator.h"
+#include "Allocators/ThreadCachedPoolAllocator.h"
 #include "Result.h"
 
 #include "Base/UPtr.h"
@@ -68,6 +69,8 @@ namespace greaper
 #include "Platform.h"
 
 #include "Base/Span.h"
+#include "Base/InlineFunction.h"
+#include "Base/BoundedMPMCQueue.h"
 
 namespace greaper::Impl
 {
@@ -0,0 +1,97 @@
+/***********************************************************************************
+*   Copyright 2022 Marcos Sánchez Torrent.                                         *
+*   All Rights Reserved.                                                           *
+***********************************************************************************/
+
+#pragma once
+
+#ifndef CORE_PARALLEL_ALGORITHMS_H
+#define CORE_PARALLEL_ALGORITHMS_H 1
+
+#include "MPMCTaskScheduler.h"
+#include "SlimTaskScheduler.h"
+
+namespace greaper
+{
+	namespace Impl
+	{
+		/*** Shared state of a parallel loop
+		*	The range is split in chunks of Grain elements which are claimed one
+		*	by one by the participants, so faster threads simply take more chunks.
+		*	Helper tasks may start after the loop has finished, that's why it
+		*	lives on the heap and is released by its last user.
+		*/
+		struct ParallelRange
+		{
+			/*** Chunks created per participant when the grain is not given */
+			static constexpr sizet ChunksPerParticipant = 4;
+
+			std::atomic<uint32> References{ 1 };
+			std::atomic<sizet> NextChunk{ 0 };
+			std::atomic<uint32> FinishedChunks{ 0 };
+			std::atomic<uint32> Waiters{ 0 };
+			sizet Begin = 0;
+			sizet End = 0;
+			sizet Grain = 1;
+			uint32 ChunkCount = 0;
+
+			bool ClaimChunk(sizet& chunkBegin, sizet& chunkEnd)noexcept;
+
+			void FinishChunks(uint32 count)noexcept;
+
+			void WaitUntilFinished()noexcept;
+		};
+
+		template<class WorkFn>
+		struct ParallelJob : ParallelRange
+		{
+			WorkFn Work;
+
+			ParallelJob(const WorkFn& work)noexcept;
+
+			void Release()noexcept;
+		};
+
+		bool SubmitParallelTask(const PTaskScheduler& scheduler, TaskFunction workFn)noexcept;
+		bool SubmitParallelTask(const PSlimScheduler& scheduler, TaskFunction workFn)noexcept;
+
+		/*** Runs participant(range) on the caller and on as many workers as useful, returns once every chunk is done */
+		template<class Scheduler, class Participant>
+		void ParallelRun(const SPtr<Scheduler>& scheduler, sizet begin, sizet end, sizet grain, Participant&& participant)noexcept;
+	}
+
+	/*** Calls fn(index) for every index in [begin, end) using the scheduler workers
+	*
+	*	The calling thread works on the loop too, and returns once every index
+	*	has been processed, so fn can reference local state. grain is the amount
+	*	of indices handled per chunk, when zero is picked from the range size
+	*	and the worker count. It's safe to call it from a worker of the same
+	*	scheduler, and if the scheduler is null or can't take more tasks the
+	*	caller just does all the work.
+	*/
+	template<class Scheduler, class F>
+	void ParallelFor(const SPtr<Scheduler>& scheduler, sizet begin, sizet end, sizet grain, F&& fn)noexcept;
+
+	/*** Calls fn(element) for every element of range, see the index based ParallelFor */
+	template<class Scheduler, class T, class F>
+	void ParallelFor(const SPtr<Scheduler>& scheduler, const Span<T>& range, sizet grain, F&& fn)noexcept;
+
+	template<class Scheduler, class T, class F>
+	void ParallelFor(const SPtr<Scheduler>& scheduler, const CSpan<T>& range, sizet grain, F&& fn)noexcept;
+
+	/*** Reduces map(element) of every element of range with combine(R, R) -> R
+	*
+	*	Each participant reduces its chunks starting from identity and the
+	*	partial results are combined as they finish, so combine must be
+	*	associative and commutative, and identity must not change the result.
+	*/
+	template<class Scheduler, class T, class R, class MapFn, class CombineFn>
+	R ParallelReduce(const SPtr<Scheduler>& scheduler, const CSpan<T>& range, R identity, MapFn&& map, CombineFn&& combine, sizet grain = 0)noexcept;
+
+	template<class Scheduler, class T, class R, class MapFn, class CombineFn>
+	R ParallelReduce(const SPtr<Scheduler>& scheduler, const Span<T>& range, R identity, MapFn&& map, CombineFn&& combine, sizet grain = 0)noexcept;
+}
+
+#include "Base/ParallelAlgorithms.inl"
+
+#endif /* CORE_PARALLEL_ALGORITHMS_H */
@@ -70,13 +70,17 @@ namespace greaper
 #include "Win/WinPlatform.h"
 #include <intrin.h>
 #define cpuid(out, x) __cpuidex(out, x, 0)
+#define cpuidex(out, x, sub) __cpuidex(out, x, sub)
 #elif PLT_LINUX
 #include "Lnx/LnxPlatform.h"
 #include <cpuid.h>
 #include <x86intrin.h>
 #define cpuid(out, x) __cpuid_count(x, 0, out[0], out[1], out[2], out[3])
+#define cpuidex(out, x, sub) __cpuid_count(x, sub, out[0], out[1], out[2], out[3])
 #endif
 
+#include "Base/SIMDDispatch.h"
+
 namespace greaper
 {
 	class OSPlatform
@@ -93,15 +97,21 @@ namespace greaper
 
 		static const CPUInfo& GetCPUInfo()noexcept;
 
+		static const CPUTopology& GetCPUTopology()noexcept;
+
 	private:
 		static inline CPUInfo m_CPUInfo;
+		static inline CPUTopology m_CPUTopology;
 
 		static void InitCPUInfo()noexcept;
+
+		static void InitCPUTopology()noexcept;
 	};
 }
 
 #include "Base/Platform.inl"
 
 #undef cpuid
+#undef cpuidex
 
 #endif /* CORE_PLATFORM_H */
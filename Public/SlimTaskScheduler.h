@@ -28,8 +28,11 @@ namespace greaper
 			DONE
 		};
 
-		std::function<void()> Task = nullptr;
+		TaskFunction Task = nullptr;
 		std::atomic_int State = DONE;
+		// Increased each time the slot task is done, waiters sleep on it until it changes
+		std::atomic<uint32> Generation{ 0 };
+		std::atomic<uint32> Waiters{ 0 };
 
 		SlimTask()noexcept = default;
 	};
@@ -37,6 +40,14 @@ namespace greaper
 	class SlimTaskScheduler
 	{
 	public:
+		/*** Task IDs hold the slot in the lower bits and its generation in the upper bits */
+		static constexpr uint32 TaskIDSlotBits = 8;
+		static constexpr uint32 TaskIDSlotMask = (1u << TaskIDSlotBits) - 1;
+		static constexpr uint32 TaskIDGenerationMask = 0xFFFFFFFFu >> TaskIDSlotBits;
+		/*** Amount of tasks that can be scheduled at the same time, set through GREAPER_SLIM_TASK_CAPACITY */
+		static constexpr uint32 TaskCapacity = GREAPER_SLIM_TASK_CAPACITY;
+		static_assert(TaskCapacity <= (1u << TaskIDSlotBits), "GREAPER_SLIM_TASK_CAPACITY doesn't fit in the task ID slot bits.");
+
 		template<class _Alloc_ = GenericAllocator>
 		static PSlimScheduler Create(WThreadManager threadMgr, StringView name, sizet workerCount, bool allowGrowth = true)noexcept;
 
@@ -48,7 +59,7 @@ namespace greaper
 		sizet GetWorkerCount()const noexcept;
 		EmptyResult SetWorkerCount(sizet count)noexcept;
 
-		TResult<uint32> AddTask(std::function<void()> task)noexcept;
+		TResult<uint32> AddTask(TaskFunction task)noexcept;
 
 		void WaitUntilTaskFinished(uint32 taskID)const noexcept;
 
@@ -66,14 +77,19 @@ namespace greaper
 		Vector<PThread> m_TaskWorkers;
 		mutable RWMutex m_TaskWorkersMutex;
 
-		uint32 m_LastTaskSlotUsed;
-		std::array<SlimTask, 32> m_TaskSlots;
-		mutable Mutex m_TaskQueueMutex;
-		mutable Signal m_TaskQueueSignal;
-		//Deque<SlimTask*> m_TaskQueue;
+		std::array<SlimTask, TaskCapacity> m_TaskSlots;
+		// Slots are handed through lock-free rings, both are as big as the slot array
+		using SlotRing_t = BoundedMPMCQueue<uint32, TaskCapacity>;
+		SlotRing_t m_FreeSlots;
+		SlotRing_t m_ReadySlots;
 
-		//Vector<SlimTask*> m_FreeTaskPool;
-		//mutable Mutex m_FreeTaskPoolMutex;
+		// Parking, sleepers wait on the epoch until someone increments it
+		std::atomic<uint32> m_WorkEpoch{ 0 };
+		std::atomic<uint32> m_SleepingWorkers{ 0 };
+		std::atomic<uint32> m_FreeSlotEpoch{ 0 };
+		std::atomic<uint32> m_FreeSlotWaiters{ 0 };
+		mutable std::atomic<uint32> m_PendingTasks{ 0 };
+		mutable std::atomic<uint32> m_FinishWaiters{ 0 };
 
 		SPtr<SlimTaskScheduler> m_This;
 		bool m_AllowGrowth;
@@ -94,11 +110,13 @@ namespace greaper
 
 		static void WorkerFn(SlimTaskScheduler& scheduler, sizet id)noexcept;
 
-		bool IsTaskQueueEmpty()const noexcept;
+		uint32 AcquireFreeSlot()noexcept;
+
+		void ExecuteSlot(uint32 slotIdx)noexcept;
 
-		bool IsAnyTaskReady(uint32& queueTaskID, uint32 prevHandledTask = 0)const noexcept;
+		static void PushSlot(SlotRing_t& ring, uint32 slotIdx)noexcept;
 
-		bool IsNextTaskAvailable()const noexcept;
+		static void WakeUp(std::atomic<uint32>& epoch, const std::atomic<uint32>& sleepers, bool all)noexcept;
 	};
 }
 
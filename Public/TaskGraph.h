@@ -0,0 +1,95 @@
+/***********************************************************************************
+*   Copyright 2022 Marcos Sánchez Torrent.                                         *
+*   All Rights Reserved.                                                           *
+***********************************************************************************/
+
+#pragma once
+
+#ifndef CORE_TASK_GRAPH_H
+#define CORE_TASK_GRAPH_H 1
+
+#include "MPMCTaskScheduler.h"
+#include "SlimTaskScheduler.h"
+
+namespace greaper
+{
+	namespace Impl
+	{
+		struct TaskGraphNode
+		{
+			String Name{};
+			TaskFunction WorkFn = nullptr;
+			Vector<uint32> Successors{};
+			uint32 PredecessorCount = 0;
+			std::atomic<uint32> PendingPredecessors{ 0 };
+			std::atomic<TaskState_t> State{ TaskState_t::Inactive };
+		};
+	}
+
+	/*** Directed acyclic graph of tasks executed on a task scheduler
+	*
+	*	Nodes declare their predecessors through AddDependency, once the graph
+	*	is dispatched the nodes without predecessors are scheduled and every
+	*	node schedules its successors as soon as their last predecessor has
+	*	completed, no thread is blocked in between stages.
+	*	When a node completes and releases successors, the first one is executed
+	*	right away by the same worker, so linear chains don't pay a wake-up per stage.
+	*
+	*	The graph cannot be modified while is running, but can be dispatched
+	*	again once it has finished. WaitUntilFinish must not be called from a
+	*	worker of the scheduler running the graph.
+	*/
+	class TaskGraph
+	{
+	public:
+		using NodeID = uint32;
+		static constexpr NodeID InvalidNode = (NodeID)-1;
+
+		explicit TaskGraph(StringView name = "TaskGraph"sv)noexcept;
+		~TaskGraph()noexcept;
+
+		TaskGraph(const TaskGraph&) = delete;
+		TaskGraph& operator=(const TaskGraph&) = delete;
+
+		TResult<NodeID> AddNode(StringView name, TaskFunction workFn)noexcept;
+
+		/*** Makes successor wait until predecessor has been completed */
+		EmptyResult AddDependency(NodeID predecessor, NodeID successor)noexcept;
+
+		EmptyResult Dispatch(const PTaskScheduler& scheduler)noexcept;
+		EmptyResult Dispatch(const PSlimScheduler& scheduler)noexcept;
+
+		NODISCARD TaskState_t GetNodeState(NodeID node)const noexcept;
+
+		NODISCARD bool IsRunning()const noexcept;
+
+		void WaitUntilFinish()const noexcept;
+
+		NODISCARD sizet GetNodeCount()const noexcept;
+
+		NODISCARD const String& GetName()const noexcept;
+
+	private:
+		using SubmitFn_t = std::function<bool(StringView name, TaskFunction workFn)>;
+
+		String m_Name;
+		Deque<Impl::TaskGraphNode> m_Nodes;
+		SubmitFn_t m_Submit;
+		std::atomic<sizet> m_RemainingNodes{ 0 };
+		std::atomic_bool m_Running{ false };
+		mutable Mutex m_FinishedMutex;
+		mutable Signal m_FinishedSignal;
+
+		EmptyResult Launch(SubmitFn_t submit)noexcept;
+
+		bool HasCycles()const noexcept;
+
+		void Schedule(NodeID node)noexcept;
+
+		void RunNode(NodeID node)noexcept;
+	};
+}
+
+#include "Base/TaskGraph.inl"
+
+#endif /* CORE_TASK_GRAPH_H */
@@ -252,6 +252,27 @@ ResumeThread(
 	HANDLE hThread
 );
 
+BOOL
+WINAPI
+WaitOnAddress(
+	volatile VOID* Address,
+	PVOID CompareAddress,
+	SIZE_T AddressSize,
+	DWORD dwMilliseconds
+);
+
+VOID
+WINAPI
+WakeByAddressSingle(
+	PVOID Address
+);
+
+VOID
+WINAPI
+WakeByAddressAll(
+	PVOID Address
+);
+
 #ifndef _INC_PROCESS
 
 typedef unsigned(__stdcall* _beginthreadex_proc_type)(void*);
@@ -274,4 +295,6 @@ DECLSPEC_IMPORT void __cdecl _endthreadex(
 
 #endif
 
+#pragma comment(lib, "Synchronization.lib")
+
 #endif /* CORE_WIN32_CONCURRENCY_H */
\ No newline at end of file
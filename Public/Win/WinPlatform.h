@@ -64,6 +64,9 @@ namespace greaper
 		
 		static void _PerLibraryInit();
 
+		/*** Fills the topology from GetLogicalProcessorInformationEx */
+		static void _InitCPUTopology(CPUTopology& topology)noexcept;
+
 		static void DetectWindowsVersion()noexcept;
 
 		static constexpr sizet MAX_STACKTRACE_DEPTH = 200;
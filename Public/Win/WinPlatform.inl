@@ -146,6 +146,75 @@ INLINE void greaper::WinOSPlatform::_PerLibraryInit()
 	DetectWindowsVersion();
 }
 
+inline void greaper::WinOSPlatform::_InitCPUTopology(CPUTopology& topology) noexcept
+{
+	DWORD length = 0;
+	GetLogicalProcessorInformationEx(RelationAll, nullptr, &length);
+	if (GetLastError() != ERROR_INSUFFICIENT_BUFFER)
+		return;
+	Vector<uint8> buffer(length);
+	if (!GetLogicalProcessorInformationEx(RelationAll, (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)buffer.data(), &length))
+		return;
+
+	// Logical CPUs are numbered consecutively across processor groups
+	const auto getCPUs = [](const GROUP_AFFINITY& affinity)
+	{
+		Vector<uint32> cpus;
+		for (uint32 i = 0; i < sizeof(KAFFINITY) * 8; ++i)
+		{
+			if ((affinity.Mask & ((KAFFINITY)1 << i)) != 0)
+				cpus.push_back((uint32)affinity.Group * (uint32)(sizeof(KAFFINITY) * 8) + i);
+		}
+		return cpus;
+	};
+
+	uint32 logicalCount = 0;
+	for (DWORD offset = 0; offset < length;)
+	{
+		const auto* info = (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)(buffer.data() + offset);
+		switch (info->Relationship)
+		{
+		case RelationProcessorCore:
+		{
+			auto cpus = getCPUs(info->Processor.GroupMask[0]);
+			logicalCount += (uint32)cpus.size();
+			topology.SMTSiblings.push_back(std::move(cpus));
+			break;
+		}
+		case RelationProcessorPackage:
+			++topology.PackageCount;
+			break;
+		case RelationNumaNode:
+		{
+			const auto node = (sizet)info->NumaNode.NodeNumber;
+			if (topology.NUMANodes.size() <= node)
+				topology.NUMANodes.resize(node + 1);
+			topology.NUMANodes[node] = getCPUs(info->NumaNode.GroupMask);
+			break;
+		}
+		case RelationCache:
+		{
+			const auto& cacheInfo = info->Cache;
+			if (cacheInfo.Type == CacheTrace)
+				break;
+			CPUCacheInfo cache;
+			cache.Level = cacheInfo.Level;
+			cache.Type = cacheInfo.Type == CacheData ? CPUCacheType_t::DATA : (cacheInfo.Type == CacheInstruction ? CPUCacheType_t::INSTRUCTION : CPUCacheType_t::UNIFIED);
+			cache.Size = cacheInfo.CacheSize;
+			cache.LineSize = cacheInfo.LineSize;
+			cache.Associativity = cacheInfo.Associativity;
+			topology.AddCacheInstance(cache, getCPUs(cacheInfo.GroupMask));
+			break;
+		}
+		default:
+			break;
+		}
+		offset += info->Size;
+	}
+	if (logicalCount > 0)
+		topology.LogicalCoreCount = logicalCount;
+}
+
 INLINE void greaper::WinOSPlatform::DetectWindowsVersion() noexcept
 {
 	auto IsWinVerOrGreater = [](WORD majorVer, WORD minorVer, WORD servicePackMajor)
@@ -22,6 +22,9 @@ namespace greaper
 		std::function<void()> m_ThreadFn;
 		bool m_JoinsAtDestruction;
 		String m_Name;
+		ThreadAffinityMask m_Affinity;
+		ThreadSchedulingPolicy_t m_SchedulingPolicy;
+		int32 m_PreferredNUMANode;
 		IInterface::ActivationEvt_t::HandlerType m_OnManagerActivation;
 		IApplication::OnInterfaceActivationEvent_t::HandlerType m_OnNewManager;
 		//PThread m_This;
@@ -37,6 +40,8 @@ namespace greaper
 			if (winThread == nullptr)
 				return EXIT_FAILURE;
 
+			winThread->ApplyPlacement();
+
 			if(!winThread->m_Manager.expired())
 			{
 				auto mgr = winThread->m_Manager.lock();
@@ -123,6 +128,34 @@ namespace greaper
 #endif
 		}
 
+		void ApplyPlacement()noexcept
+		{
+			// Only the first processor group is supported
+			ULONGLONG affinity = 0;
+			for (sizet cpu = 0; cpu < 64; ++cpu)
+			{
+				if (m_Affinity.test(cpu))
+					affinity |= 1ull << cpu;
+			}
+			// Windows already allocates from the node of the CPU running the thread
+			if (affinity == 0 && m_PreferredNUMANode >= 0 && !GetNumaNodeProcessorMask((UCHAR)m_PreferredNUMANode, &affinity))
+				affinity = 0;
+			if (affinity != 0 && SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)affinity) == 0)
+				DEBUG_OUTPUT(Format("SetThreadAffinityMask() failed, error code " I32_HEX_FMT, GetLastError()).c_str());
+
+			int priority = THREAD_PRIORITY_NORMAL;
+			switch (m_SchedulingPolicy)
+			{
+			case ThreadSchedulingPolicy_t::Batch: priority = THREAD_PRIORITY_BELOW_NORMAL; break;
+			case ThreadSchedulingPolicy_t::Idle: priority = THREAD_PRIORITY_IDLE; break;
+			case ThreadSchedulingPolicy_t::RoundRobin: priority = THREAD_PRIORITY_HIGHEST; break;
+			case ThreadSchedulingPolicy_t::FIFO: priority = THREAD_PRIORITY_TIME_CRITICAL; break;
+			default: return;
+			}
+			if (!SetThreadPriority(GetCurrentThread(), priority))
+				DEBUG_OUTPUT(Format("SetThreadPriority() failed, error code " I32_HEX_FMT, GetLastError()).c_str());
+		}
+
 		void OnManagerActivation(bool active, IInterface* oldManager, const PInterface& newManager)noexcept
 		{
 			if (active)
@@ -169,6 +202,9 @@ namespace greaper
 			,m_ThreadFn(config.ThreadFN)
 			,m_JoinsAtDestruction(config.JoinAtDestruction)
 			,m_Name(config.Name)
+			,m_Affinity(config.Affinity)
+			,m_SchedulingPolicy(config.SchedulingPolicy)
+			,m_PreferredNUMANode(config.PreferredNUMANode)
 			//,m_This(std::move(self))
 			,m_Barier(2)
 		{
@@ -214,6 +250,8 @@ namespace greaper
 			,m_ThreadFn(nullptr)
 			,m_JoinsAtDestruction(false)
 			,m_Name(name)
+			,m_SchedulingPolicy(ThreadSchedulingPolicy_t::Default)
+			,m_PreferredNUMANode(-1)
 		{
 			if (setName)
 				SetName();
@@ -239,6 +239,27 @@ namespace greaper
 			}
 		};
 		using SignalImpl = WinSignalImpl;
+
+		struct WinAddressWaitImpl
+		{
+			INLINE static void Wait(volatile uint32* address, uint32 expected) noexcept
+			{
+				WaitOnAddress(address, &expected, sizeof(expected), INFINITE);
+			}
+			INLINE static bool WaitFor(volatile uint32* address, uint32 expected, uint32 millis) noexcept
+			{
+				return WaitOnAddress(address, &expected, sizeof(expected), millis);
+			}
+			INLINE static void WakeOne(volatile uint32* address) noexcept
+			{
+				WakeByAddressSingle((PVOID)address);
+			}
+			INLINE static void WakeAll(volatile uint32* address) noexcept
+			{
+				WakeByAddressAll((PVOID)address);
+			}
+		};
+		using AddressWaitImpl = WinAddressWaitImpl;
 	}
 }
 